@@ -0,0 +1,170 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "GpuProfiler.h"
+
+namespace
+{
+	std::string escape(const std::string& text)
+	{
+		std::string escaped;
+		for (char c : text)
+		{
+			if (c == '\\' || c == '"')
+			{
+				escaped += '\\';
+			}
+			escaped += c;
+		}
+		return escaped;
+	}
+
+	float percentile(const std::vector<float>& sorted, float p)
+	{
+		if (sorted.empty())
+		{
+			return 0.0f;
+		}
+		const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * static_cast<float>(sorted.size())));
+		return sorted[index];
+	}
+
+	void writeSummary(std::ofstream& out, const std::vector<float>& samples)
+	{
+		std::vector<float> sorted = samples;
+		std::sort(sorted.begin(), sorted.end());
+		float sum = 0.0f;
+		for (float sample : sorted)
+		{
+			sum += sample;
+		}
+
+		out << "{\"samples\":" << sorted.size()
+			<< ",\"mean\":" << (sorted.empty() ? 0.0f : sum / static_cast<float>(sorted.size()))
+			<< ",\"min\":" << (sorted.empty() ? 0.0f : sorted.front())
+			<< ",\"p50\":" << percentile(sorted, 0.5f)
+			<< ",\"p90\":" << percentile(sorted, 0.9f)
+			<< ",\"p95\":" << percentile(sorted, 0.95f)
+			<< ",\"p99\":" << percentile(sorted, 0.99f)
+			<< ",\"max\":" << (sorted.empty() ? 0.0f : sorted.back()) << "}";
+	}
+}
+
+Benchmark::Benchmark(const BenchmarkSettings& settings)
+	: m_settings(settings)
+{
+	m_cpuMs.reserve(m_settings.frames);
+	m_gpuMs.reserve(m_settings.frames);
+	m_simulationMs.reserve(m_settings.frames);
+	m_latencyMs.reserve(m_settings.frames);
+}
+
+bool Benchmark::isFinished() const
+{
+	const int measuredEnd = m_settings.warmupFrames + m_settings.frames;
+	//Frames whose GPU queries were dropped never resolve, so stop waiting after a full ring
+	return m_frame >= measuredEnd &&
+		(static_cast<int>(m_gpuMs.size()) >= m_settings.frames || m_frame >= measuredEnd + GpuProfiler::FRAME_LATENCY);
+}
+
+void Benchmark::endFrame(float cpuMs, const GpuProfiler& gpuProfiler)
+{
+	const int measuredEnd = m_settings.warmupFrames + m_settings.frames;
+	if (m_frame >= m_settings.warmupFrames && m_frame < measuredEnd)
+	{
+		m_cpuMs.push_back(cpuMs);
+	}
+
+	const int64_t resolved = gpuProfiler.getResolvedFrame();
+	if (resolved >= m_settings.warmupFrames && resolved < measuredEnd && resolved != m_lastGpuFrame)
+	{
+		m_lastGpuFrame = resolved;
+		m_gpuMs.push_back(gpuProfiler.getFrameMs());
+		for (const GpuPassTiming& timing : gpuProfiler.getTimings())
+		{
+			if (timing.frame != resolved)
+			{
+				continue;
+			}
+
+			auto pass = std::find_if(m_passes.begin(), m_passes.end(), [&timing](const PassSamples& p) { return p.name == timing.name; });
+			if (pass == m_passes.end())
+			{
+				m_passes.push_back({ timing.name, {} });
+				pass = m_passes.end() - 1;
+			}
+			pass->samples.push_back(timing.lastMs);
+		}
+	}
+
+	m_frame++;
+}
+
+void Benchmark::addSimulationTime(int64_t frame, float ms)
+{
+	if (isMeasured(frame))
+	{
+		m_simulationMs.push_back(ms);
+	}
+}
+
+void Benchmark::addLatency(int64_t frame, float ms)
+{
+	if (isMeasured(frame))
+	{
+		m_latencyMs.push_back(ms);
+	}
+}
+
+bool Benchmark::isMeasured(int64_t frame) const
+{
+	return frame >= m_settings.warmupFrames && frame < m_settings.warmupFrames + m_settings.frames;
+}
+
+void Benchmark::setParameter(const std::string& name, int value)
+{
+	m_parameters.emplace_back(name, value);
+}
+
+bool Benchmark::writeReport() const
+{
+	std::ofstream out(m_settings.reportPath);
+	if (!out)
+	{
+		std::cout << "ERROR::BENCHMARK::REPORT_NOT_WRITTEN " << m_settings.reportPath << std::endl;
+		return false;
+	}
+
+	out << std::fixed << std::setprecision(4);
+	out << "{\n\"scene\":\"" << escape(m_settings.scene) << "\",\n\"cameraPath\":\"" << escape(m_settings.cameraPath) << "\",\n"
+		<< "\"warmupFrames\":" << m_settings.warmupFrames << ",\n\"frames\":" << m_settings.frames << ",\n"
+		<< "\"timestep\":" << m_settings.timestep << ",\n";
+	out << "\"parameters\":{";
+	for (size_t i = 0; i < m_parameters.size(); i++)
+	{
+		out << (i ? "," : "") << "\"" << escape(m_parameters[i].first) << "\":" << m_parameters[i].second;
+	}
+	out << "},\n";
+	out << "\"cpuFrameMs\":";
+	writeSummary(out, m_cpuMs);
+	out << ",\n\"gpuFrameMs\":";
+	writeSummary(out, m_gpuMs);
+	out << ",\n\"simulationMs\":";
+	writeSummary(out, m_simulationMs);
+	out << ",\n\"inputLatencyMs\":";
+	writeSummary(out, m_latencyMs);
+	out << ",\n\"passes\":{";
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		out << (i ? ",\n" : "\n") << "\"" << m_passes[i].name << "\":";
+		writeSummary(out, m_passes[i].samples);
+	}
+	out << "\n}\n}\n";
+
+	std::cout << "Benchmark report written to " << m_settings.reportPath << std::endl;
+	return true;
+}
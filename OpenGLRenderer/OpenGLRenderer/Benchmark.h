@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class GpuProfiler;
+
+struct BenchmarkSettings
+{
+	//Model file rendered in place of the default scene's props, "default" keeps them
+	std::string	scene = "default";
+	std::string	cameraPath;
+	std::string	reportPath = "benchmark.json";
+	int			warmupFrames = 120;
+	int			frames = 1000;
+	//Simulation step per frame, independent of how long the frame took
+	float		timestep = 1.0f / 60.0f;
+};
+
+//Collects per-frame timings of a benchmark run and writes them as a JSON report. Warmup frames
+//are rendered but not recorded. GPU frame times arrive GpuProfiler::FRAME_LATENCY - 1 frames late,
+//so a few extra frames are rendered at the end until every measured frame is resolved.
+class Benchmark
+{
+public:
+	explicit Benchmark(const BenchmarkSettings& settings);
+
+	[[nodiscard]] const BenchmarkSettings& getSettings() const
+	{
+		return m_settings;
+	}
+
+	//Simulation time of the frame about to be rendered
+	[[nodiscard]] float getTime() const
+	{
+		return static_cast<float>(m_frame) * m_settings.timestep;
+	}
+
+	[[nodiscard]] bool isFinished() const;
+
+	//Call once per frame after the frame was submitted
+	void endFrame(float cpuMs, const GpuProfiler& gpuProfiler);
+
+	//Per frame results measured outside the render loop, kept when the frame is in the measured range
+	void addSimulationTime(int64_t frame, float ms);
+	void addLatency(int64_t frame, float ms);
+
+	//Scene parameters written to the report, for plotting frame time against scene size
+	void setParameter(const std::string& name, int value);
+
+	bool writeReport() const;
+
+private:
+	struct PassSamples
+	{
+		std::string			name;
+		std::vector<float>	samples;
+	};
+
+	BenchmarkSettings		m_settings;
+	int						m_frame = 0;
+	int64_t					m_lastGpuFrame = -1;
+	std::vector<float>		m_cpuMs;
+	std::vector<float>		m_gpuMs;
+	std::vector<float>		m_simulationMs;
+	std::vector<float>		m_latencyMs;
+	std::vector<PassSamples>	m_passes;
+	std::vector<std::pair<std::string, int>>	m_parameters;
+
+	[[nodiscard]] bool isMeasured(int64_t frame) const;
+};
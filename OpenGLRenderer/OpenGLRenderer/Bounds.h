@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cfloat>
+
+#include <glm.hpp>
+
+struct AABB
+{
+	glm::vec3 min = glm::vec3(FLT_MAX);
+	glm::vec3 max = glm::vec3(-FLT_MAX);
+
+	bool isValid() const
+	{
+		return min.x <= max.x && min.y <= max.y && min.z <= max.z;
+	}
+
+	glm::vec3 getCenter() const
+	{
+		return (min + max) * 0.5f;
+	}
+
+	glm::vec3 getExtents() const
+	{
+		return (max - min) * 0.5f;
+	}
+
+	void expand(const glm::vec3& point)
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	void expand(const AABB& other)
+	{
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	float surfaceArea() const
+	{
+		const glm::vec3 d = max - min;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+
+	//Arvo's method: transformed box stays axis aligned and conservative
+	AABB transformed(const glm::mat4& m) const
+	{
+		const glm::vec3 center = glm::vec3(m * glm::vec4(getCenter(), 1.0f));
+		const glm::vec3 extents = getExtents();
+		const glm::mat3 absM = glm::mat3(glm::abs(glm::vec3(m[0])), glm::abs(glm::vec3(m[1])), glm::abs(glm::vec3(m[2])));
+		const glm::vec3 newExtents = absM * extents;
+
+		AABB result;
+		result.min = center - newExtents;
+		result.max = center + newExtents;
+		return result;
+	}
+};
@@ -93,6 +93,15 @@ public:
 		updateCameraVectors();
 	}
 
+	//Places the camera directly, used when it is driven by a recorded path instead of input
+	void SetPose(const glm::vec3& position, float newYaw, float newPitch)
+	{
+		cameraPos = position;
+		yaw = newYaw;
+		pitch = newPitch;
+		updateCameraVectors();
+	}
+
 	const glm::mat4x4& GetViewMatrix() const
 	{
 		return view;
@@ -0,0 +1,125 @@
+#include "CameraPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "Camera.h"
+
+namespace
+{
+	struct PathHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t count;
+	};
+}
+
+bool CameraPath::load(const std::filesystem::path& file)
+{
+	m_samples.clear();
+	m_times.clear();
+
+	std::ifstream in(file, std::ios::binary);
+	PathHeader header{};
+	in.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!in || header.magic != MAGIC || header.version != VERSION)
+	{
+		std::cout << "ERROR::CAMERA_PATH::INVALID_FILE " << file.generic_string() << std::endl;
+		return false;
+	}
+
+	m_samples.resize(header.count);
+	in.read(reinterpret_cast<char*>(m_samples.data()), m_samples.size() * sizeof(CameraSample));
+	if (!in)
+	{
+		std::cout << "ERROR::CAMERA_PATH::TRUNCATED_FILE " << file.generic_string() << std::endl;
+		m_samples.clear();
+		return false;
+	}
+
+	const std::vector<CameraSample> samples = std::move(m_samples);
+	m_samples.clear();
+	for (const CameraSample& sample : samples)
+	{
+		add(sample);
+	}
+	return true;
+}
+
+bool CameraPath::save(const std::filesystem::path& file) const
+{
+	std::ofstream out(file, std::ios::binary);
+	const PathHeader header{ MAGIC, VERSION, static_cast<uint32_t>(m_samples.size()) };
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(m_samples.data()), m_samples.size() * sizeof(CameraSample));
+	if (!out)
+	{
+		std::cout << "ERROR::CAMERA_PATH::FILE_NOT_WRITTEN " << file.generic_string() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+void CameraPath::add(const CameraSample& sample)
+{
+	m_times.push_back(m_samples.empty() ? 0.0f : m_times.back() + sample.deltaTime);
+	m_samples.push_back(sample);
+}
+
+CameraSample CameraPath::sampleAt(float time) const
+{
+	if (m_samples.empty())
+	{
+		return CameraSample{ glm::vec3(0.0f), -90.0f, 0.0f, 0.0f };
+	}
+
+	const auto next = std::upper_bound(m_times.begin(), m_times.end(), time);
+	if (next == m_times.begin())
+	{
+		return m_samples.front();
+	}
+	if (next == m_times.end())
+	{
+		return m_samples.back();
+	}
+
+	const size_t i = static_cast<size_t>(next - m_times.begin());
+	const CameraSample& a = m_samples[i - 1];
+	const CameraSample& b = m_samples[i];
+	const float span = m_times[i] - m_times[i - 1];
+	const float t = span > 0.0f ? (time - m_times[i - 1]) / span : 1.0f;
+
+	float yawDelta = std::fmod(b.yaw - a.yaw, 360.0f);
+	if (yawDelta > 180.0f)
+	{
+		yawDelta -= 360.0f;
+	}
+	else if (yawDelta < -180.0f)
+	{
+		yawDelta += 360.0f;
+	}
+
+	CameraSample sample;
+	sample.position = glm::mix(a.position, b.position, t);
+	sample.yaw = a.yaw + yawDelta * t;
+	sample.pitch = glm::mix(a.pitch, b.pitch, t);
+	sample.deltaTime = b.deltaTime;
+	return sample;
+}
+
+void CameraPath::apply(float time, Camera& camera) const
+{
+	const CameraSample sample = sampleAt(time);
+	camera.SetPose(sample.position, sample.yaw, sample.pitch);
+}
+
+void CameraPath::applySample(size_t index, Camera& camera) const
+{
+	const CameraSample& sample = m_samples[index];
+	camera.SetPose(sample.position, sample.yaw, sample.pitch);
+}
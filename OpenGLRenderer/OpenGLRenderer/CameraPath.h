@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <glm.hpp>
+
+class Camera;
+
+struct CameraSample
+{
+	glm::vec3	position;
+	float		yaw;
+	float		pitch;
+	//Frame time the pose was recorded with, the first sample's is not part of the path's timing
+	float		deltaTime;
+};
+
+//Camera poses over time, stored as a flat binary file of CameraSample records behind a small header.
+//Recording appends one sample per frame. Replaying sample by sample restores the recorded floats
+//exactly, so runs are bit-identical; sampleAt instead interpolates between samples as keyframes
+//for replays at a fixed timestep. Yaw is interpolated along the shorter arc.
+class CameraPath
+{
+public:
+	static constexpr uint32_t MAGIC = 0x48545043; // "CPTH"
+	static constexpr uint32_t VERSION = 1;
+
+	bool load(const std::filesystem::path& file);
+	bool save(const std::filesystem::path& file) const;
+
+	void add(const CameraSample& sample);
+
+	[[nodiscard]] bool empty() const
+	{
+		return m_samples.empty();
+	}
+
+	[[nodiscard]] float getDuration() const
+	{
+		return m_times.empty() ? 0.0f : m_times.back();
+	}
+
+	const std::vector<CameraSample>& getSamples() const
+	{
+		return m_samples;
+	}
+
+	//Interpolated pose at time seconds from the start, clamped to the path
+	CameraSample sampleAt(float time) const;
+	void apply(float time, Camera& camera) const;
+	//Exact pose of one recorded sample
+	void applySample(size_t index, Camera& camera) const;
+
+private:
+	std::vector<CameraSample>	m_samples;
+	//Time of each sample from the start of the path
+	std::vector<float>			m_times;
+};
@@ -0,0 +1,332 @@
+#include "ClusteredLighting.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include <immintrin.h>
+
+#include "CpuProfiler.h"
+#include "GpuMemoryTracker.h"
+#include "JobSystem.h"
+#include "RenderStats.h"
+
+namespace
+{
+	//Texels of RGBA32F light data per light, matches CalcLocalLight in Lighting.glsl
+	constexpr uint32_t LIGHT_TEXELS = 5;
+	//Attenuated contribution below which a light is considered out of range
+	constexpr float RANGE_THRESHOLD = 1.0f / 256.0f;
+
+	unsigned int createBufferTexture(unsigned int& buffer, size_t size, GLenum format)
+	{
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+		GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, buffer, size, "Texture buffer", "ClusteredLighting");
+
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_BUFFER, texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		return texture;
+	}
+
+	void uploadBuffer(unsigned int buffer, size_t capacity, const void* data, size_t size)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		//Orphan so last frame's data can still be read
+		glBufferData(GL_TEXTURE_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+		if (size > 0)
+		{
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+		}
+		RenderStats::current().bytesUploaded += size;
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+}
+
+ClusteredLighting::ClusteredLighting(int width, int height)
+	: m_width(width), m_height(height),
+	m_clusterCounts(CLUSTER_COUNT), m_clusterLights(static_cast<size_t>(CLUSTER_COUNT) * MAX_LIGHTS_PER_CLUSTER),
+	m_grid(CLUSTER_COUNT)
+{
+	m_lightTexture = createBufferTexture(m_lightBuffer, MAX_LIGHTS * LIGHT_TEXELS * sizeof(glm::vec4), GL_RGBA32F);
+	m_gridTexture = createBufferTexture(m_gridBuffer, CLUSTER_COUNT * sizeof(glm::uvec2), GL_RG32UI);
+	m_indexTexture = createBufferTexture(m_indexBuffer, MAX_LIGHT_INDICES * sizeof(uint32_t), GL_R32UI);
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+	glDeleteTextures(1, &m_lightTexture);
+	glDeleteTextures(1, &m_gridTexture);
+	glDeleteTextures(1, &m_indexTexture);
+	glDeleteBuffers(1, &m_lightBuffer);
+	glDeleteBuffers(1, &m_gridBuffer);
+	glDeleteBuffers(1, &m_indexBuffer);
+
+	GpuMemoryTracker& tracker = GpuMemoryTracker::get();
+	tracker.release(GpuResourceKind::BUFFER, m_lightBuffer);
+	tracker.release(GpuResourceKind::BUFFER, m_gridBuffer);
+	tracker.release(GpuResourceKind::BUFFER, m_indexBuffer);
+}
+
+void ClusteredLighting::update(const std::vector<LocalLight>& lights, const glm::mat4& view, const glm::mat4& projection, float near, float far)
+{
+	PROFILE_SCOPE("ClusteredLighting::update");
+	if (projection != m_projection || near != m_near || far != m_far)
+	{
+		m_projection = projection;
+		m_near = near;
+		m_far = far;
+		buildClusterBounds();
+	}
+
+	const uint32_t lightCount = std::min(static_cast<uint32_t>(lights.size()), MAX_LIGHTS);
+	m_stats = ClusterStats();
+	m_stats.lights = lightCount;
+	m_stats.overflow = lights.size() > MAX_LIGHTS;
+
+	std::fill(m_clusterCounts.begin(), m_clusterCounts.end(), 0);
+	m_lightData.clear();
+	m_viewSpheres.clear();
+	for (uint32_t i = 0; i < lightCount; i++)
+	{
+		const LocalLight& light = lights[i];
+		const float range = light.range > 0.0f ? light.range : computeRange(light);
+
+		m_lightData.push_back(glm::vec4(light.position, range));
+		m_lightData.push_back(glm::vec4(light.diffuse * light.intensity, static_cast<float>(light.type)));
+		m_lightData.push_back(glm::vec4(light.specular * light.intensity, light.cutOff));
+		m_lightData.push_back(glm::vec4(glm::normalize(light.direction), light.outerCutOff));
+		m_lightData.push_back(glm::vec4(light.constant, light.linear, light.quadratic, static_cast<float>(light.shadowIndex)));
+
+		//Spot lights are bounded by the sphere of their range
+		m_viewSpheres.push_back(glm::vec4(glm::vec3(view * glm::vec4(light.position, 1.0f)), range));
+	}
+
+	//Jobs own disjoint depth slices and walk the lights in order, so the lists match a serial pass
+	std::atomic<bool> overflow{ false };
+	JobSystem::get().parallelFor("ClusteredLighting::assign", SLICES, 2, [this, &overflow](size_t begin, size_t end)
+	{
+		bool sliceOverflow = false;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(m_viewSpheres.size()); i++)
+		{
+			sliceOverflow |= assignLight(i, glm::vec3(m_viewSpheres[i]), m_viewSpheres[i].w, static_cast<int>(begin), static_cast<int>(end));
+		}
+		if (sliceOverflow)
+		{
+			overflow = true;
+		}
+	});
+	m_stats.overflow |= overflow.load();
+
+	//Compact the fixed size per-cluster lists into one index list
+	m_indices.clear();
+	for (int cluster = 0; cluster < CLUSTER_COUNT; cluster++)
+	{
+		const uint32_t* clusterLights = m_clusterLights.data() + static_cast<size_t>(cluster) * MAX_LIGHTS_PER_CLUSTER;
+		uint32_t count = m_clusterCounts[cluster];
+		if (m_indices.size() + count > MAX_LIGHT_INDICES)
+		{
+			count = MAX_LIGHT_INDICES - static_cast<uint32_t>(m_indices.size());
+			m_stats.overflow = true;
+		}
+
+		m_grid[cluster] = glm::uvec2(static_cast<uint32_t>(m_indices.size()), count);
+		m_indices.insert(m_indices.end(), clusterLights, clusterLights + count);
+		m_stats.maxLightsPerCluster = std::max(m_stats.maxLightsPerCluster, count);
+	}
+	m_stats.lightIndices = static_cast<uint32_t>(m_indices.size());
+
+	uploadBuffer(m_lightBuffer, MAX_LIGHTS * LIGHT_TEXELS * sizeof(glm::vec4), m_lightData.data(), m_lightData.size() * sizeof(glm::vec4));
+	uploadBuffer(m_gridBuffer, CLUSTER_COUNT * sizeof(glm::uvec2), m_grid.data(), m_grid.size() * sizeof(glm::uvec2));
+	uploadBuffer(m_indexBuffer, MAX_LIGHT_INDICES * sizeof(uint32_t), m_indices.data(), m_indices.size() * sizeof(uint32_t));
+}
+
+void ClusteredLighting::bind(const Shader& shader, int firstUnit) const
+{
+	//slice = log(depth) * scale + bias
+	const float logRatio = std::log(m_far / m_near);
+	const float sliceScale = SLICES / logRatio;
+	const float sliceBias = -SLICES * std::log(m_near) / logRatio;
+
+	shader.setIVec3("_ClusterDims", TILES_X, TILES_Y, SLICES);
+	shader.setVec2("_ClusterScreenScale", static_cast<float>(TILES_X) / m_width, static_cast<float>(TILES_Y) / m_height);
+	shader.setVec2("_ClusterDepthParams", sliceScale, sliceBias);
+	shader.setFloat("_Near", m_near);
+	shader.setFloat("_Far", m_far);
+
+	shader.setInt("_LightData", firstUnit);
+	shader.setInt("_ClusterGrid", firstUnit + 1);
+	shader.setInt("_LightIndices", firstUnit + 2);
+
+	glActiveTexture(GL_TEXTURE0 + firstUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, m_lightTexture);
+	glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+	glBindTexture(GL_TEXTURE_BUFFER, m_gridTexture);
+	glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+	glBindTexture(GL_TEXTURE_BUFFER, m_indexTexture);
+	glActiveTexture(GL_TEXTURE0);
+	RenderStats::current().textureBinds += 3;
+}
+
+float ClusteredLighting::computeRange(const LocalLight& light)
+{
+	//Solve intensity / (c + l*d + q*d^2) = threshold for d
+	const float brightest = light.intensity * std::max({ light.diffuse.r, light.diffuse.g, light.diffuse.b,
+		light.specular.r, light.specular.g, light.specular.b });
+	const float c = light.constant - brightest / RANGE_THRESHOLD;
+	if (c >= 0.0f)
+	{
+		return 0.0f;
+	}
+
+	if (light.quadratic <= 0.0f)
+	{
+		return light.linear > 0.0f ? -c / light.linear : 0.0f;
+	}
+
+	return (-light.linear + std::sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
+}
+
+void ClusteredLighting::buildClusterBounds()
+{
+	const glm::mat4 invProjection = glm::inverse(m_projection);
+
+	//View space points on the near plane for every tile corner, rays from the eye go through them
+	glm::vec3 corners[TILES_Y + 1][TILES_X + 1];
+	for (int y = 0; y <= TILES_Y; y++)
+	{
+		for (int x = 0; x <= TILES_X; x++)
+		{
+			const glm::vec4 ndc(-1.0f + 2.0f * x / TILES_X, -1.0f + 2.0f * y / TILES_Y, -1.0f, 1.0f);
+			const glm::vec4 viewPos = invProjection * ndc;
+			corners[y][x] = glm::vec3(viewPos) / viewPos.w;
+		}
+	}
+
+	for (int slice = 0; slice < SLICES; slice++)
+	{
+		const float sliceNear = m_near * std::pow(m_far / m_near, static_cast<float>(slice) / SLICES);
+		const float sliceFar = m_near * std::pow(m_far / m_near, static_cast<float>(slice + 1) / SLICES);
+
+		for (int y = 0; y < TILES_Y; y++)
+		{
+			for (int x = 0; x < TILES_X; x++)
+			{
+				glm::vec3 boundsMin(FLT_MAX);
+				glm::vec3 boundsMax(-FLT_MAX);
+				for (int corner = 0; corner < 4; corner++)
+				{
+					const glm::vec3& nearPoint = corners[y + (corner >> 1)][x + (corner & 1)];
+					for (float depth : { sliceNear, sliceFar })
+					{
+						const glm::vec3 point = nearPoint * (depth / -nearPoint.z);
+						boundsMin = glm::min(boundsMin, point);
+						boundsMax = glm::max(boundsMax, point);
+					}
+				}
+
+				const int cluster = (slice * TILES_Y + y) * TILES_X + x;
+				m_minX[cluster] = boundsMin.x;
+				m_minY[cluster] = boundsMin.y;
+				m_minZ[cluster] = boundsMin.z;
+				m_maxX[cluster] = boundsMax.x;
+				m_maxY[cluster] = boundsMax.y;
+				m_maxZ[cluster] = boundsMax.z;
+			}
+		}
+	}
+}
+
+bool ClusteredLighting::assignLight(uint32_t light, const glm::vec3& viewCenter, float radius, int sliceBegin, int sliceEnd)
+{
+	const float minDepth = -viewCenter.z - radius;
+	const float maxDepth = -viewCenter.z + radius;
+	if (radius <= 0.0f || maxDepth < m_near || minDepth > m_far)
+	{
+		return false;
+	}
+
+	const int firstSlice = std::max(depthToSlice(std::max(minDepth, m_near)), sliceBegin);
+	const int lastSlice = std::min(depthToSlice(std::min(maxDepth, m_far)), sliceEnd - 1);
+	bool overflow = false;
+
+	for (int slice = firstSlice; slice <= lastSlice; slice++)
+	{
+		for (int y = 0; y < TILES_Y; y++)
+		{
+			const int rowStart = (slice * TILES_Y + y) * TILES_X;
+			uint32_t mask = testRow(rowStart, viewCenter, radius * radius);
+			while (mask != 0)
+			{
+				int x = 0;
+				while ((mask & (1u << x)) == 0)
+				{
+					x++;
+				}
+				mask &= ~(1u << x);
+
+				const int cluster = rowStart + x;
+				uint32_t& count = m_clusterCounts[cluster];
+				if (count < MAX_LIGHTS_PER_CLUSTER)
+				{
+					m_clusterLights[static_cast<size_t>(cluster) * MAX_LIGHTS_PER_CLUSTER + count++] = light;
+				}
+				else
+				{
+					overflow = true;
+				}
+			}
+		}
+	}
+	return overflow;
+}
+
+uint32_t ClusteredLighting::testRow(int rowStart, const glm::vec3& center, float radiusSq) const
+{
+	//Squared distance from the sphere center to each box of the row, one bit per overlapping cluster
+	uint32_t mask = 0;
+#if defined(__AVX__)
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 cx = _mm256_set1_ps(center.x);
+	const __m256 cy = _mm256_set1_ps(center.y);
+	const __m256 cz = _mm256_set1_ps(center.z);
+	const __m256 r2 = _mm256_set1_ps(radiusSq);
+	for (int x = 0; x < TILES_X; x += 8)
+	{
+		const int first = rowStart + x;
+		const __m256 dx = _mm256_max_ps(zero, _mm256_max_ps(_mm256_sub_ps(_mm256_load_ps(m_minX + first), cx), _mm256_sub_ps(cx, _mm256_load_ps(m_maxX + first))));
+		const __m256 dy = _mm256_max_ps(zero, _mm256_max_ps(_mm256_sub_ps(_mm256_load_ps(m_minY + first), cy), _mm256_sub_ps(cy, _mm256_load_ps(m_maxY + first))));
+		const __m256 dz = _mm256_max_ps(zero, _mm256_max_ps(_mm256_sub_ps(_mm256_load_ps(m_minZ + first), cz), _mm256_sub_ps(cz, _mm256_load_ps(m_maxZ + first))));
+		const __m256 distSq = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+		mask |= static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(distSq, r2, _CMP_LE_OQ))) << x;
+	}
+#else
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 cx = _mm_set1_ps(center.x);
+	const __m128 cy = _mm_set1_ps(center.y);
+	const __m128 cz = _mm_set1_ps(center.z);
+	const __m128 r2 = _mm_set1_ps(radiusSq);
+	for (int x = 0; x < TILES_X; x += 4)
+	{
+		const int first = rowStart + x;
+		const __m128 dx = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_load_ps(m_minX + first), cx), _mm_sub_ps(cx, _mm_load_ps(m_maxX + first))));
+		const __m128 dy = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_load_ps(m_minY + first), cy), _mm_sub_ps(cy, _mm_load_ps(m_maxY + first))));
+		const __m128 dz = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(_mm_load_ps(m_minZ + first), cz), _mm_sub_ps(cz, _mm_load_ps(m_maxZ + first))));
+		const __m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		mask |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(distSq, r2))) << x;
+	}
+#endif
+	return mask;
+}
+
+int ClusteredLighting::depthToSlice(float depth) const
+{
+	const int slice = static_cast<int>(std::floor(std::log(depth / m_near) / std::log(m_far / m_near) * SLICES));
+	return std::clamp(slice, 0, SLICES - 1);
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "LocalLight.h"
+#include "Shader.h"
+
+//Clustered forward lighting: the view frustum is split into screen tiles and exponential depth slices.
+//Lights are assigned to clusters on the CPU each frame, testing a light's sphere against a row of
+//cluster bounds at once with SSE/AVX. The light data, per-cluster (offset, count) and the flat index
+//list are uploaded to buffer textures, so the fragment shader only loops over its cluster's lights.
+class ClusteredLighting
+{
+public:
+	//TILES_X must be a multiple of 8 for the SIMD row test
+	static constexpr int TILES_X = 16;
+	static constexpr int TILES_Y = 9;
+	static constexpr int SLICES = 24;
+	static constexpr int CLUSTER_COUNT = TILES_X * TILES_Y * SLICES;
+	static constexpr uint32_t MAX_LIGHTS = 1024;
+	static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+	static constexpr uint32_t MAX_LIGHT_INDICES = CLUSTER_COUNT * 32;
+
+	ClusteredLighting(int width, int height);
+	ClusteredLighting(const ClusteredLighting& other) = delete;
+	~ClusteredLighting();
+
+	//Rebuilds cluster bounds when the projection changes, then assigns and uploads lights
+	void update(const std::vector<LocalLight>& lights, const glm::mat4& view, const glm::mat4& projection, float near, float far);
+
+	//Binds light data, cluster grid and index list to consecutive texture units starting at firstUnit
+	void bind(const Shader& shader, int firstUnit) const;
+
+	[[nodiscard]] const ClusterStats& getStats() const
+	{
+		return m_stats;
+	}
+
+	static float computeRange(const LocalLight& light);
+
+private:
+	int				m_width;
+	int				m_height;
+	glm::mat4		m_projection = glm::mat4(0.0f);
+	float			m_near = 0.0f;
+	float			m_far = 0.0f;
+
+	//View space cluster bounds as structure of arrays, rows of TILES_X are contiguous
+	alignas(32) float m_minX[CLUSTER_COUNT];
+	alignas(32) float m_minY[CLUSTER_COUNT];
+	alignas(32) float m_minZ[CLUSTER_COUNT];
+	alignas(32) float m_maxX[CLUSTER_COUNT];
+	alignas(32) float m_maxY[CLUSTER_COUNT];
+	alignas(32) float m_maxZ[CLUSTER_COUNT];
+
+	std::vector<uint32_t>	m_clusterCounts;
+	std::vector<uint32_t>	m_clusterLights;
+	std::vector<glm::uvec2>	m_grid;
+	std::vector<uint32_t>	m_indices;
+	std::vector<glm::vec4>	m_lightData;
+	//View space center and range of every light
+	std::vector<glm::vec4>	m_viewSpheres;
+
+	//Buffer textures
+	unsigned int	m_lightBuffer = 0;
+	unsigned int	m_lightTexture = 0;
+	unsigned int	m_gridBuffer = 0;
+	unsigned int	m_gridTexture = 0;
+	unsigned int	m_indexBuffer = 0;
+	unsigned int	m_indexTexture = 0;
+
+	ClusterStats	m_stats;
+
+	void buildClusterBounds();
+	//Adds light to the overlapped clusters of slices [sliceBegin, sliceEnd), returns true when a list overflowed
+	bool assignLight(uint32_t light, const glm::vec3& viewCenter, float radius, int sliceBegin, int sliceEnd);
+	uint32_t testRow(int rowStart, const glm::vec3& center, float radiusSq) const;
+	int depthToSlice(float depth) const;
+};
@@ -0,0 +1,172 @@
+#include "CpuProfiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> CpuProfiler::s_enabled{ false };
+
+namespace
+{
+	struct Event
+	{
+		const char*	name;
+		uint64_t	start;
+		uint64_t	end;
+		uint32_t	threadId;
+	};
+
+	//Written only by the owning thread, head is published after the slot so dump() can skip
+	//slots that may be overwritten while it reads
+	struct ThreadBuffer
+	{
+		std::vector<Event>		events = std::vector<Event>(CpuProfiler::EVENTS_PER_THREAD);
+		std::atomic<uint64_t>	head{ 0 };
+	};
+
+	struct Registry
+	{
+		std::mutex									mutex;
+		std::vector<std::unique_ptr<ThreadBuffer>>	buffers;
+		std::vector<ThreadBuffer*>					freeBuffers;
+		std::atomic<uint32_t>						nextThreadId{ 1 };
+		const std::chrono::steady_clock::time_point	epoch = std::chrono::steady_clock::now();
+
+		uint64_t									frameStarts[CpuProfiler::MAX_FRAMES] = {};
+		uint64_t									frameCount = 0;
+	};
+
+	Registry& registry()
+	{
+		static Registry instance;
+		return instance;
+	}
+
+	struct ThreadSlot
+	{
+		ThreadBuffer*	buffer = nullptr;
+		uint32_t		threadId = 0;
+
+		ThreadSlot()
+		{
+			Registry& reg = registry();
+			threadId = reg.nextThreadId++;
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			if (!reg.freeBuffers.empty())
+			{
+				buffer = reg.freeBuffers.back();
+				reg.freeBuffers.pop_back();
+			}
+			else
+			{
+				reg.buffers.push_back(std::make_unique<ThreadBuffer>());
+				buffer = reg.buffers.back().get();
+			}
+		}
+
+		~ThreadSlot()
+		{
+			Registry& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			reg.freeBuffers.push_back(buffer);
+		}
+	};
+
+	ThreadSlot& threadSlot()
+	{
+		thread_local ThreadSlot slot;
+		return slot;
+	}
+}
+
+uint64_t CpuProfiler::now()
+{
+	const auto elapsed = std::chrono::steady_clock::now() - registry().epoch;
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+void CpuProfiler::record(const char* name, uint64_t start, uint64_t end)
+{
+	ThreadSlot& slot = threadSlot();
+	ThreadBuffer& buffer = *slot.buffer;
+	const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+	buffer.events[head % EVENTS_PER_THREAD] = { name, start, end, slot.threadId };
+	buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void CpuProfiler::beginFrame()
+{
+	if (!isEnabled())
+	{
+		return;
+	}
+	Registry& reg = registry();
+	std::lock_guard<std::mutex> lock(reg.mutex);
+	reg.frameStarts[reg.frameCount % MAX_FRAMES] = now();
+	reg.frameCount++;
+}
+
+bool CpuProfiler::dump(const std::string& path, int frameCount)
+{
+	Registry& reg = registry();
+	std::vector<Event> events;
+	{
+		std::lock_guard<std::mutex> lock(reg.mutex);
+
+		frameCount = std::clamp(frameCount, 1, MAX_FRAMES);
+		uint64_t cutoff = 0;
+		if (reg.frameCount >= static_cast<uint64_t>(frameCount))
+		{
+			cutoff = reg.frameStarts[(reg.frameCount - frameCount) % MAX_FRAMES];
+		}
+
+		for (const std::unique_ptr<ThreadBuffer>& buffer : reg.buffers)
+		{
+			const uint64_t head = buffer->head.load(std::memory_order_acquire);
+			const uint64_t first = head > EVENTS_PER_THREAD ? head - EVENTS_PER_THREAD : 0;
+			std::vector<Event> copied;
+			for (uint64_t i = first; i < head; i++)
+			{
+				copied.push_back(buffer->events[i % EVENTS_PER_THREAD]);
+			}
+
+			//Skip the oldest slots if the owner wrapped around onto them while we were copying
+			const uint64_t headAfter = buffer->head.load(std::memory_order_acquire);
+			const uint64_t lost = headAfter > first + EVENTS_PER_THREAD ? headAfter - first - EVENTS_PER_THREAD : 0;
+			for (size_t i = static_cast<size_t>(std::min<uint64_t>(lost, copied.size())); i < copied.size(); i++)
+			{
+				if (copied[i].start >= cutoff)
+				{
+					events.push_back(copied[i]);
+				}
+			}
+		}
+	}
+
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cout << "ERROR::CPU_PROFILER::FILE_NOT_WRITTEN " << path << std::endl;
+		return false;
+	}
+
+	//Complete events, timestamps in microseconds
+	std::sort(events.begin(), events.end(), [](const Event& a, const Event& b) { return a.start < b.start; });
+	file << std::fixed << std::setprecision(3);
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	for (size_t i = 0; i < events.size(); i++)
+	{
+		const Event& event = events[i];
+		file << (i ? ",\n" : "\n")
+			<< "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.threadId
+			<< ",\"ts\":" << event.start / 1000.0 << ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+	}
+	file << "\n]}\n";
+	std::cout << "CPU trace of " << events.size() << " events written to " << path << std::endl;
+	return true;
+}
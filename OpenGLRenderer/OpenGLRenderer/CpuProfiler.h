@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+//name must be a string literal, only the pointer is stored
+#define PROFILE_SCOPE(name) CpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+
+//Scoped CPU timing markers written to per-thread ring buffers and exported as Chrome trace JSON
+//(chrome://tracing or ui.perfetto.dev). Each thread owns its buffer, so recording takes no locks.
+//Buffers of finished threads go back to a pool and are reused by new ones, so restarting the job
+//system workers does not grow the registry. While disabled a scope costs one branch.
+class CpuProfiler
+{
+public:
+	//Events kept per thread, older ones are overwritten
+	static constexpr uint32_t EVENTS_PER_THREAD = 1 << 16;
+	//Frame start times kept for dump()
+	static constexpr int MAX_FRAMES = 256;
+
+	static void setEnabled(bool enabled)
+	{
+		s_enabled.store(enabled, std::memory_order_relaxed);
+	}
+
+	static bool isEnabled()
+	{
+		return s_enabled.load(std::memory_order_relaxed);
+	}
+
+	//Marks the start of a frame on the main thread
+	static void beginFrame();
+
+	//Writes every event of the last frameCount frames, returns false when the file cannot be written
+	static bool dump(const std::string& path, int frameCount = MAX_FRAMES);
+
+	//Nanoseconds since the profiler was first used
+	static uint64_t now();
+	static void record(const char* name, uint64_t start, uint64_t end);
+
+private:
+	static std::atomic<bool> s_enabled;
+};
+
+class CpuProfileScope
+{
+public:
+	explicit CpuProfileScope(const char* name)
+	{
+		if (CpuProfiler::isEnabled())
+		{
+			m_name = name;
+			m_start = CpuProfiler::now();
+		}
+	}
+
+	CpuProfileScope(const CpuProfileScope& other) = delete;
+
+	~CpuProfileScope()
+	{
+		if (m_name)
+		{
+			CpuProfiler::record(m_name, m_start, CpuProfiler::now());
+		}
+	}
+
+private:
+	const char*	m_name = nullptr;
+	uint64_t	m_start = 0;
+};
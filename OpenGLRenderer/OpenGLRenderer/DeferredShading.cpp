@@ -0,0 +1,104 @@
+#include "DeferredShading.h"
+
+#include <iostream>
+
+#include "GpuMemoryTracker.h"
+#include "RenderStats.h"
+
+namespace
+{
+	unsigned int createTarget(int width, int height, GLint internalFormat, GLenum format, GLenum type)
+	{
+		unsigned int texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		return texture;
+	}
+}
+
+DeferredShading::DeferredShading(int width, int height, unsigned int depthTexture, const std::vector<std::string>& lightingDefines)
+	: m_depthTexture(depthTexture)
+{
+	m_albedoSpecular = createTarget(width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+	m_normalRoughness = createTarget(width, height, GL_RGBA16, GL_RGBA, GL_UNSIGNED_SHORT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, m_albedoSpecular,
+		GpuMemoryTracker::textureBytes(width, height, 1, 4, false), "RGBA8", "G-buffer");
+	GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, m_normalRoughness,
+		GpuMemoryTracker::textureBytes(width, height, 1, 8, false), "RGBA16", "G-buffer");
+
+	glGenFramebuffers(1, &m_FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_albedoSpecular, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, m_normalRoughness, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+
+	const GLenum drawBuffers[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR::DEFERRED::GBUFFER_INCOMPLETE" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	glGenVertexArrays(1, &m_emptyVAO);
+	m_lightingShader = std::make_unique<Shader>("Shaders/DeferredLighting.vs", "Shaders/DeferredLighting.fs", lightingDefines);
+}
+
+DeferredShading::~DeferredShading()
+{
+	glDeleteFramebuffers(1, &m_FBO);
+	glDeleteTextures(1, &m_albedoSpecular);
+	glDeleteTextures(1, &m_normalRoughness);
+	GpuMemoryTracker::get().release(GpuResourceKind::TEXTURE, m_albedoSpecular);
+	GpuMemoryTracker::get().release(GpuResourceKind::TEXTURE, m_normalRoughness);
+	glDeleteVertexArrays(1, &m_emptyVAO);
+}
+
+void DeferredShading::beginGeometryPass() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+	RenderStats::current().fboSwitches++;
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+}
+
+void DeferredShading::lightingPass(unsigned int targetFBO, const glm::mat4& viewProjection) const
+{
+	//The depth texture is sampled, so it is detached from the target for this pass to avoid a
+	//feedback loop and reattached for the forward passes drawn afterwards
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFBO);
+	RenderStats::current().fboSwitches++;
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, 0, 0);
+	glDisable(GL_DEPTH_TEST);
+
+	m_lightingShader->use();
+	m_lightingShader->setMat4("_InvViewProjection", glm::inverse(viewProjection));
+	m_lightingShader->setInt("_GAlbedoSpecular", 0);
+	m_lightingShader->setInt("_GNormalRoughness", 1);
+	m_lightingShader->setInt("_GDepth", 2);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_albedoSpecular);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_normalRoughness);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, m_depthTexture);
+
+	glBindVertexArray(m_emptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	RenderStats::current().textureBinds += 3;
+	RenderStats::current().addDraw(3);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, m_depthTexture, 0);
+	glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory>
+
+#include "Shader.h"
+
+//Deferred path selected at startup. The G-buffer shares the main framebuffer's depth texture so
+//blended and alpha tested materials can still be drawn forward on top after the lighting pass.
+//Layout:
+//	0: RGBA8	albedo, specular intensity
+//	1: RGBA16	octahedral normal, roughness
+//	depth:		shared DEPTH24_STENCIL8, world position is rebuilt from it
+class DeferredShading
+{
+public:
+	//lightingDefines select the lighting shader permutation, e.g. the shadow filter
+	DeferredShading(int width, int height, unsigned int depthTexture, const std::vector<std::string>& lightingDefines);
+	DeferredShading(const DeferredShading& other) = delete;
+	~DeferredShading();
+
+	//Binds the G-buffer and clears its color targets, depth is cleared with the main framebuffer
+	void beginGeometryPass() const;
+
+	//Fullscreen lighting into targetFBO, which must have the shared depth texture attached.
+	//Light, shadow and IBL uniforms are set by the caller on getLightingShader(),
+	//the G-buffer is bound to texture units 0 to 2.
+	void lightingPass(unsigned int targetFBO, const glm::mat4& viewProjection) const;
+
+	[[nodiscard]] Shader& getLightingShader() const
+	{
+		return *m_lightingShader;
+	}
+
+private:
+	unsigned int			m_FBO = 0;
+	unsigned int			m_albedoSpecular = 0;
+	unsigned int			m_normalRoughness = 0;
+	unsigned int			m_depthTexture;
+	unsigned int			m_emptyVAO = 0;
+	std::unique_ptr<Shader>	m_lightingShader;
+};
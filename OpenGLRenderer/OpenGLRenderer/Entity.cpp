@@ -16,11 +16,15 @@ glm::mat4 Transform::getLocalModelMatrix()
 void Transform::computeModelMatrix()
 {
 	modelMatrix = getLocalModelMatrix();
+	isDirty = false;
+	version++;
 }
 
 void Transform::computeModelMatrix(const glm::mat4& parentModel)
 {
 	modelMatrix = parentModel * getLocalModelMatrix();
+	isDirty = false;
+	version++;
 }
 
 void Entity::updateSelfAndChild()
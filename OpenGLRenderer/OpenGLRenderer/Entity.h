@@ -14,6 +14,12 @@ protected:
 	glm::mat4 modelMatrix = glm::mat4(1.0f);
 
 	bool isDirty = true;
+	//Incremented every time the model matrix is recomputed
+	uint32_t version = 0;
+
+	//Matrix and version of the frame being rendered, written only by the thread that renders
+	glm::mat4 renderMatrix = glm::mat4(1.0f);
+	uint32_t renderVersion = 0;
 
 protected:
 	glm::mat4 getLocalModelMatrix();
@@ -38,7 +44,7 @@ public:
 		isDirty = true;
 	}
 
-	const glm::mat4 getModelMatrix()
+	const glm::mat4& getModelMatrix() const
 	{
 		return modelMatrix;
 	}
@@ -47,6 +53,34 @@ public:
 	{
 		return isDirty;
 	}
+
+	uint32_t getVersion() const
+	{
+		return version;
+	}
+
+	//Makes the simulated matrix visible to the renderer, only while no frame is in flight
+	void publish()
+	{
+		renderMatrix = modelMatrix;
+		renderVersion = version;
+	}
+
+	void applySnapshot(const glm::mat4& model, uint32_t snapshotVersion)
+	{
+		renderMatrix = model;
+		renderVersion = snapshotVersion;
+	}
+
+	const glm::mat4& getRenderMatrix() const
+	{
+		return renderMatrix;
+	}
+
+	uint32_t getRenderVersion() const
+	{
+		return renderVersion;
+	}
 };
 
 class Entity : public Model
@@ -59,15 +93,25 @@ public:
 
 	}
 
+	explicit Entity(std::vector<Mesh> generatedMeshes) : Model(std::move(generatedMeshes))
+	{
+
+	}
+
 	template<typename... TArgs>
-	void addChild(const TArgs&... args)
+	void addChild(TArgs&&... args)
 	{
-		childrens.emplace_back(std::make_unique<Entity>(args...));
+		childrens.emplace_back(std::make_unique<Entity>(std::forward<TArgs>(args)...));
 		childrens.back()->parent = this;
 	}
 
 	void updateSelfAndChild();
 
+	AABB getWorldBounds() const
+	{
+		return getBounds().transformed(transform.getRenderMatrix());
+	}
+
 	const std::unique_ptr<Entity>& getChild(int index) const;
 private:
 	void forceUpdateSelfAndChild();
@@ -0,0 +1,107 @@
+#include "FramePipeline.h"
+
+#include "CpuProfiler.h"
+
+FrameSnapshot* FramePipeline::beginWrite()
+{
+	PROFILE_SCOPE("FramePipeline::beginWrite");
+	std::unique_lock<std::mutex> lock(m_mutex);
+	int slot = -1;
+	m_changed.wait(lock, [this, &slot]()
+	{
+		for (int i = 0; i < SLOT_COUNT; i++)
+		{
+			if (m_states[i] == SlotState::FREE)
+			{
+				slot = i;
+				return true;
+			}
+		}
+		return m_stopped;
+	});
+
+	if (m_stopped)
+	{
+		return nullptr;
+	}
+
+	m_states[slot] = SlotState::WRITING;
+	m_writing = slot;
+	return &m_slots[slot];
+}
+
+void FramePipeline::publish()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_states[m_writing] = SlotState::READY;
+		m_writing = -1;
+	}
+	m_changed.notify_all();
+}
+
+const FrameSnapshot* FramePipeline::acquire()
+{
+	PROFILE_SCOPE("FramePipeline::acquire");
+	std::unique_lock<std::mutex> lock(m_mutex);
+	int slot = -1;
+	m_changed.wait(lock, [this, &slot]()
+	{
+		//Oldest ready snapshot first, frames are never skipped
+		for (int i = 0; i < SLOT_COUNT; i++)
+		{
+			if (m_states[i] == SlotState::READY && (slot < 0 || m_slots[i].frameIndex < m_slots[slot].frameIndex))
+			{
+				slot = i;
+			}
+		}
+		return slot >= 0 || m_stopped;
+	});
+
+	if (slot < 0)
+	{
+		return nullptr;
+	}
+
+	m_states[slot] = SlotState::READING;
+	m_reading = slot;
+	return &m_slots[slot];
+}
+
+void FramePipeline::release()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_states[m_reading] = SlotState::FREE;
+		m_reading = -1;
+	}
+	m_changed.notify_all();
+}
+
+void FramePipeline::stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stopped = true;
+	}
+	m_changed.notify_all();
+}
+
+void FramePipeline::submitInput(const InputState& input)
+{
+	std::lock_guard<std::mutex> lock(m_inputMutex);
+	const float mouseDx = m_input.mouseDx + input.mouseDx;
+	const float mouseDy = m_input.mouseDy + input.mouseDy;
+	m_input = input;
+	m_input.mouseDx = mouseDx;
+	m_input.mouseDy = mouseDy;
+}
+
+InputState FramePipeline::takeInput()
+{
+	std::lock_guard<std::mutex> lock(m_inputMutex);
+	InputState input = m_input;
+	m_input.mouseDx = 0.0f;
+	m_input.mouseDy = 0.0f;
+	return input;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <glm.hpp>
+
+//Keyboard and mouse input gathered on the thread that processes window events
+struct InputState
+{
+	bool	forward = false;
+	bool	backward = false;
+	bool	left = false;
+	bool	right = false;
+	//Mouse movement summed over every poll since the simulation last took the input
+	float	mouseDx = 0.0f;
+	float	mouseDy = 0.0f;
+	//Newest poll, start of the input-to-present measurement
+	std::chrono::steady_clock::time_point	sampleTime;
+};
+
+struct TransformSnapshot
+{
+	glm::mat4	model;
+	uint32_t	version;
+};
+
+//Everything the renderer reads about one simulated frame. Written by the simulation before
+//FramePipeline::publish and left untouched until the renderer releases it.
+struct FrameSnapshot
+{
+	uint64_t	frameIndex = 0;
+	float		time = 0.0f;
+	float		deltaTime = 0.0f;
+
+	glm::vec3	cameraPos = glm::vec3(0.0f);
+	glm::vec3	cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
+	glm::mat4	view = glm::mat4(1.0f);
+
+	//World matrices of the scene entities, in the order they were registered
+	std::vector<TransformSnapshot>	transforms;
+
+	std::chrono::steady_clock::time_point	inputTime;
+	float		simulationMs = 0.0f;
+	//Last frame of a replay, the window closes once it is presented
+	bool		quit = false;
+};
+
+//Hands frame snapshots from the simulation to the renderer through two slots, so frame N+1 is
+//simulated while frame N is submitted. Input travels the other way. When a single thread calls
+//both sides in turn it behaves like the serial loop.
+class FramePipeline
+{
+public:
+	static constexpr int SLOT_COUNT = 2;
+
+	//Simulation side, blocks until a slot is free. nullptr once stopped
+	FrameSnapshot* beginWrite();
+	void publish();
+
+	//Render side, blocks until the next snapshot is published. nullptr once stopped and drained
+	const FrameSnapshot* acquire();
+	void release();
+
+	void stop();
+
+	void submitInput(const InputState& input);
+	//Input gathered since the last call, the mouse movement is consumed
+	InputState takeInput();
+
+private:
+	enum class SlotState
+	{
+		FREE,
+		WRITING,
+		READY,
+		READING
+	};
+
+	std::mutex				m_mutex;
+	std::condition_variable	m_changed;
+	FrameSnapshot			m_slots[SLOT_COUNT];
+	SlotState				m_states[SLOT_COUNT] = { SlotState::FREE, SlotState::FREE };
+	int						m_writing = -1;
+	int						m_reading = -1;
+	bool					m_stopped = false;
+
+	std::mutex				m_inputMutex;
+	InputState				m_input;
+};
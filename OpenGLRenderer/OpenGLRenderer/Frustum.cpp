@@ -0,0 +1,112 @@
+#include "Frustum.h"
+
+#include <immintrin.h>
+
+Frustum::Frustum(const glm::mat4& worldToClip)
+{
+	update(worldToClip);
+}
+
+void Frustum::update(const glm::mat4& worldToClip) noexcept
+{
+	//Gribb/Hartmann plane extraction, glm matrices are column major
+	const glm::vec4 row0(worldToClip[0][0], worldToClip[1][0], worldToClip[2][0], worldToClip[3][0]);
+	const glm::vec4 row1(worldToClip[0][1], worldToClip[1][1], worldToClip[2][1], worldToClip[3][1]);
+	const glm::vec4 row2(worldToClip[0][2], worldToClip[1][2], worldToClip[2][2], worldToClip[3][2]);
+	const glm::vec4 row3(worldToClip[0][3], worldToClip[1][3], worldToClip[2][3], worldToClip[3][3]);
+
+	const glm::vec4 planes[PLANE_COUNT] =
+	{
+		row3 + row0,	//left
+		row3 - row0,	//right
+		row3 + row1,	//bottom
+		row3 - row1,	//top
+		row3 + row2,	//near
+		row3 - row2		//far
+	};
+
+	for (int i = 0; i < PLANE_COUNT; i++)
+	{
+		const float invLength = 1.0f / glm::length(glm::vec3(planes[i]));
+		m_planeX[i] = planes[i].x * invLength;
+		m_planeY[i] = planes[i].y * invLength;
+		m_planeZ[i] = planes[i].z * invLength;
+		m_planeW[i] = planes[i].w * invLength;
+	}
+
+	for (int i = PLANE_COUNT; i < 8; i++)
+	{
+		m_planeX[i] = 0.0f;
+		m_planeY[i] = 0.0f;
+		m_planeZ[i] = 0.0f;
+		m_planeW[i] = 1.0f;
+	}
+}
+
+CullResult Frustum::testAABB(const AABB& box) const noexcept
+{
+	const glm::vec3 center = box.getCenter();
+	const glm::vec3 extents = box.getExtents();
+
+#if defined(__AVX__)
+	const __m256 signMask = _mm256_set1_ps(-0.0f);
+	const __m256 px = _mm256_load_ps(m_planeX);
+	const __m256 py = _mm256_load_ps(m_planeY);
+	const __m256 pz = _mm256_load_ps(m_planeZ);
+	const __m256 pw = _mm256_load_ps(m_planeW);
+
+	//Signed distance of the box center to each plane
+	__m256 dist = _mm256_add_ps(_mm256_mul_ps(px, _mm256_set1_ps(center.x)), pw);
+	dist = _mm256_add_ps(_mm256_mul_ps(py, _mm256_set1_ps(center.y)), dist);
+	dist = _mm256_add_ps(_mm256_mul_ps(pz, _mm256_set1_ps(center.z)), dist);
+
+	//Projected radius of the box onto each plane normal
+	__m256 radius = _mm256_mul_ps(_mm256_andnot_ps(signMask, px), _mm256_set1_ps(extents.x));
+	radius = _mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, py), _mm256_set1_ps(extents.y)), radius);
+	radius = _mm256_add_ps(_mm256_mul_ps(_mm256_andnot_ps(signMask, pz), _mm256_set1_ps(extents.z)), radius);
+
+	const __m256 negRadius = _mm256_xor_ps(radius, signMask);
+	if (_mm256_movemask_ps(_mm256_cmp_ps(dist, negRadius, _CMP_LT_OQ)) != 0)
+	{
+		return CullResult::OUTSIDE;
+	}
+
+	return _mm256_movemask_ps(_mm256_cmp_ps(dist, radius, _CMP_LT_OQ)) != 0 ? CullResult::INTERSECT : CullResult::INSIDE;
+#else
+	const __m128 signMask = _mm_set1_ps(-0.0f);
+	const __m128 cx = _mm_set1_ps(center.x);
+	const __m128 cy = _mm_set1_ps(center.y);
+	const __m128 cz = _mm_set1_ps(center.z);
+	const __m128 ex = _mm_set1_ps(extents.x);
+	const __m128 ey = _mm_set1_ps(extents.y);
+	const __m128 ez = _mm_set1_ps(extents.z);
+
+	int outsideMask = 0;
+	int intersectMask = 0;
+	for (int i = 0; i < 8; i += 4)
+	{
+		const __m128 px = _mm_load_ps(m_planeX + i);
+		const __m128 py = _mm_load_ps(m_planeY + i);
+		const __m128 pz = _mm_load_ps(m_planeZ + i);
+		const __m128 pw = _mm_load_ps(m_planeW + i);
+
+		__m128 dist = _mm_add_ps(_mm_mul_ps(px, cx), pw);
+		dist = _mm_add_ps(_mm_mul_ps(py, cy), dist);
+		dist = _mm_add_ps(_mm_mul_ps(pz, cz), dist);
+
+		__m128 radius = _mm_mul_ps(_mm_andnot_ps(signMask, px), ex);
+		radius = _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, py), ey), radius);
+		radius = _mm_add_ps(_mm_mul_ps(_mm_andnot_ps(signMask, pz), ez), radius);
+
+		outsideMask |= _mm_movemask_ps(_mm_cmplt_ps(dist, _mm_xor_ps(radius, signMask)));
+		intersectMask |= _mm_movemask_ps(_mm_cmplt_ps(dist, radius));
+	}
+
+	if (outsideMask != 0)
+	{
+		return CullResult::OUTSIDE;
+	}
+
+	return intersectMask != 0 ? CullResult::INTERSECT : CullResult::INSIDE;
+#endif
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm.hpp>
+
+#include "Bounds.h"
+
+enum class CullResult
+{
+	OUTSIDE,
+	INTERSECT,
+	INSIDE
+};
+
+struct CullingStats
+{
+	uint32_t nodesTested = 0;
+	uint32_t nodesCulled = 0;
+	uint32_t entitiesVisible = 0;
+
+	void reset()
+	{
+		nodesTested = 0;
+		nodesCulled = 0;
+		entitiesVisible = 0;
+	}
+};
+
+struct OcclusionStats
+{
+	uint32_t tested = 0;
+	uint32_t culled = 0;
+	//Hi-Z pyramid build or software rasterization time
+	float buildMs = 0.0f;
+};
+
+//View frustum stored as structure of arrays so all planes are tested at once with SSE/AVX.
+//The two padding planes are (0, 0, 0, 1) and never reject anything.
+class Frustum
+{
+public:
+	static constexpr int PLANE_COUNT = 6;
+
+	Frustum() = default;
+	explicit Frustum(const glm::mat4& worldToClip);
+
+	void update(const glm::mat4& worldToClip) noexcept;
+
+	CullResult testAABB(const AABB& box) const noexcept;
+	bool isVisible(const AABB& box) const noexcept
+	{
+		return testAABB(box) != CullResult::OUTSIDE;
+	}
+
+	//Normalized plane (normal, distance) in world space
+	glm::vec4 getPlane(int index) const noexcept
+	{
+		return glm::vec4(m_planeX[index], m_planeY[index], m_planeZ[index], m_planeW[index]);
+	}
+
+private:
+	alignas(32) float m_planeX[8];
+	alignas(32) float m_planeY[8];
+	alignas(32) float m_planeZ[8];
+	alignas(32) float m_planeW[8];
+};
@@ -0,0 +1,44 @@
+#include "GLExtensions.h"
+
+#ifndef GL_VERSION_4_3
+PFNGLDISPATCHCOMPUTEPROC glad_glDispatchCompute = nullptr;
+PFNGLMEMORYBARRIERPROC glad_glMemoryBarrier = nullptr;
+PFNGLDRAWELEMENTSINDIRECTPROC glad_glDrawElementsIndirect = nullptr;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glad_glMultiDrawElementsIndirect = nullptr;
+PFNGLBINDIMAGETEXTUREPROC glad_glBindImageTexture = nullptr;
+#endif
+
+namespace
+{
+	bool gl43Supported = false;
+}
+
+void GLExtensions::load(GLADloadproc loader)
+{
+	GLint major = 0;
+	GLint minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	gl43Supported = major > 4 || (major == 4 && minor >= 3);
+
+	if (!gl43Supported)
+	{
+		return;
+	}
+
+#ifndef GL_VERSION_4_3
+	glad_glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)loader("glDispatchCompute");
+	glad_glMemoryBarrier = (PFNGLMEMORYBARRIERPROC)loader("glMemoryBarrier");
+	glad_glDrawElementsIndirect = (PFNGLDRAWELEMENTSINDIRECTPROC)loader("glDrawElementsIndirect");
+	glad_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)loader("glMultiDrawElementsIndirect");
+	glad_glBindImageTexture = (PFNGLBINDIMAGETEXTUREPROC)loader("glBindImageTexture");
+
+	gl43Supported = glad_glDispatchCompute && glad_glMemoryBarrier && glad_glDrawElementsIndirect &&
+		glad_glMultiDrawElementsIndirect && glad_glBindImageTexture;
+#endif
+}
+
+bool GLExtensions::hasGL43()
+{
+	return gl43Supported;
+}
@@ -0,0 +1,136 @@
+#include "GLResource.h"
+
+#include <glad/glad.h>
+
+#include "GpuMemoryTracker.h"
+
+GLDeletionQueue& GLDeletionQueue::get()
+{
+	static GLDeletionQueue queue;
+	return queue;
+}
+
+void GLDeletionQueue::enqueue(GLObjectType type, unsigned int id)
+{
+	if (m_shutdown)
+	{
+		//The context that owned the object is gone or about to be
+		destroy({ { type, id } });
+		return;
+	}
+	m_current.push_back({ type, id });
+}
+
+void GLDeletionQueue::endFrame()
+{
+	if (!m_current.empty())
+	{
+		m_inFlight.push_back({ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(m_current) });
+		m_current.clear();
+	}
+
+	//Batches retire in submission order, stop at the first one still in flight
+	std::size_t retired = 0;
+	while (retired < m_inFlight.size())
+	{
+		GLsync fence = static_cast<GLsync>(m_inFlight[retired].fence);
+		if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			break;
+		}
+		glDeleteSync(fence);
+		destroy(m_inFlight[retired].entries);
+		retired++;
+	}
+	m_inFlight.erase(m_inFlight.begin(), m_inFlight.begin() + retired);
+}
+
+void GLDeletionQueue::shutdown()
+{
+	for (const Batch& batch : m_inFlight)
+	{
+		glDeleteSync(static_cast<GLsync>(batch.fence));
+		destroy(batch.entries);
+	}
+	m_inFlight.clear();
+	destroy(m_current);
+	m_current.clear();
+	m_shutdown = true;
+}
+
+std::size_t GLDeletionQueue::getPendingCount() const
+{
+	std::size_t count = m_current.size();
+	for (const Batch& batch : m_inFlight)
+	{
+		count += batch.entries.size();
+	}
+	return count;
+}
+
+void GLDeletionQueue::destroy(const std::vector<Entry>& entries) const
+{
+	const bool hasContext = !m_shutdown;
+	for (const Entry& entry : entries)
+	{
+		switch (entry.type)
+		{
+		case GLObjectType::BUFFER:
+			if (hasContext)
+			{
+				glDeleteBuffers(1, &entry.id);
+			}
+			GpuMemoryTracker::get().release(GpuResourceKind::BUFFER, entry.id);
+			break;
+		case GLObjectType::TEXTURE:
+			if (hasContext)
+			{
+				glDeleteTextures(1, &entry.id);
+			}
+			GpuMemoryTracker::get().release(GpuResourceKind::TEXTURE, entry.id);
+			break;
+		case GLObjectType::VERTEX_ARRAY:
+			if (hasContext)
+			{
+				glDeleteVertexArrays(1, &entry.id);
+			}
+			break;
+		case GLObjectType::FRAMEBUFFER:
+			if (hasContext)
+			{
+				glDeleteFramebuffers(1, &entry.id);
+			}
+			break;
+		case GLObjectType::PROGRAM:
+			if (hasContext)
+			{
+				glDeleteProgram(entry.id);
+			}
+			break;
+		}
+	}
+}
+
+unsigned int createGLObject(GLObjectType type)
+{
+	unsigned int id = 0;
+	switch (type)
+	{
+	case GLObjectType::BUFFER:
+		glGenBuffers(1, &id);
+		break;
+	case GLObjectType::TEXTURE:
+		glGenTextures(1, &id);
+		break;
+	case GLObjectType::VERTEX_ARRAY:
+		glGenVertexArrays(1, &id);
+		break;
+	case GLObjectType::FRAMEBUFFER:
+		glGenFramebuffers(1, &id);
+		break;
+	case GLObjectType::PROGRAM:
+		id = glCreateProgram();
+		break;
+	}
+	return id;
+}
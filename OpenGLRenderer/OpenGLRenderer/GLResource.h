@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class GLObjectType : uint8_t
+{
+	BUFFER,
+	TEXTURE,
+	VERTEX_ARRAY,
+	FRAMEBUFFER,
+	PROGRAM
+};
+
+//GL objects released by handles are deleted here once the frames that could still use them
+//have retired on the GPU, so unloading an asset mid-frame never pulls storage from under
+//commands already submitted.
+class GLDeletionQueue
+{
+public:
+	static GLDeletionQueue& get();
+
+	GLDeletionQueue(const GLDeletionQueue& other) = delete;
+
+	void enqueue(GLObjectType type, unsigned int id);
+
+	//Fences everything released this frame and deletes batches whose fence has signaled.
+	//Called once per frame after the frame's commands are submitted
+	void endFrame();
+
+	//Deletes every pending object, called before the context is destroyed.
+	//Handles released afterwards are freed together with the context
+	void shutdown();
+
+	[[nodiscard]] std::size_t getPendingCount() const;
+
+private:
+	struct Entry
+	{
+		GLObjectType	type;
+		unsigned int	id;
+	};
+
+	struct Batch
+	{
+		void*				fence;
+		std::vector<Entry>	entries;
+	};
+
+	std::vector<Entry>	m_current;
+	std::vector<Batch>	m_inFlight;
+	bool				m_shutdown = false;
+
+	GLDeletionQueue() = default;
+
+	void destroy(const std::vector<Entry>& entries) const;
+};
+
+unsigned int createGLObject(GLObjectType type);
+
+//Move-only owner of a single GL object name. Destruction hands the name to GLDeletionQueue
+template<GLObjectType Type>
+class GLHandle
+{
+public:
+	GLHandle() = default;
+
+	//Adopts an object created elsewhere, e.g. by glCreateProgram or a loader helper
+	explicit GLHandle(unsigned int id) : m_id(id)
+	{
+	}
+
+	GLHandle(const GLHandle& other) = delete;
+	GLHandle& operator=(const GLHandle& other) = delete;
+
+	GLHandle(GLHandle&& other) noexcept : m_id(other.m_id)
+	{
+		other.m_id = 0;
+	}
+
+	GLHandle& operator=(GLHandle&& other) noexcept
+	{
+		if (this != &other)
+		{
+			reset();
+			m_id = other.m_id;
+			other.m_id = 0;
+		}
+		return *this;
+	}
+
+	~GLHandle()
+	{
+		reset();
+	}
+
+	static GLHandle create()
+	{
+		return GLHandle(createGLObject(Type));
+	}
+
+	void reset()
+	{
+		if (m_id != 0)
+		{
+			GLDeletionQueue::get().enqueue(Type, m_id);
+			m_id = 0;
+		}
+	}
+
+	[[nodiscard]] unsigned int get() const
+	{
+		return m_id;
+	}
+
+	explicit operator bool() const
+	{
+		return m_id != 0;
+	}
+
+private:
+	unsigned int m_id = 0;
+};
+
+using GLBuffer = GLHandle<GLObjectType::BUFFER>;
+using GLTexture = GLHandle<GLObjectType::TEXTURE>;
+using GLVertexArray = GLHandle<GLObjectType::VERTEX_ARRAY>;
+using GLFramebuffer = GLHandle<GLObjectType::FRAMEBUFFER>;
+using GLProgram = GLHandle<GLObjectType::PROGRAM>;
@@ -0,0 +1,173 @@
+#include "GpuMemoryTracker.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+#include <glad/glad.h>
+
+#ifndef GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX
+#define GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX 0x9048
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+#define GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
+#endif
+
+namespace
+{
+	const char* KIND_NAMES[] = { "Buffers", "Textures", "Renderbuffers" };
+}
+
+GpuMemoryTracker& GpuMemoryTracker::get()
+{
+	static GpuMemoryTracker tracker;
+	return tracker;
+}
+
+GpuMemoryTracker::~GpuMemoryTracker()
+{
+	//Runs after main's objects are destroyed, whatever is left was never deleted
+	std::ofstream file("gpu_memory_report.txt");
+	if (file)
+	{
+		writeReport(file);
+	}
+	if (!m_allocations.empty())
+	{
+		std::cout << "GPU memory: " << m_allocations.size() << " objects (" << m_currentBytes / 1024
+			<< " KB) never deleted, see gpu_memory_report.txt" << std::endl;
+	}
+}
+
+void GpuMemoryTracker::allocate(GpuResourceKind kind, unsigned int id, uint64_t bytes, const char* format, const char* tag)
+{
+	auto found = m_allocations.find(makeKey(kind, id));
+	if (found != m_allocations.end())
+	{
+		m_currentBytes -= found->second.bytes;
+		found->second.bytes = bytes;
+		found->second.format = format;
+	}
+	else
+	{
+		m_allocations.emplace(makeKey(kind, id), Allocation{ kind, id, bytes, format, tag, m_frame });
+	}
+	m_currentBytes += bytes;
+	m_peakBytes = std::max(m_peakBytes, m_currentBytes);
+}
+
+void GpuMemoryTracker::release(GpuResourceKind kind, unsigned int id)
+{
+	auto found = m_allocations.find(makeKey(kind, id));
+	if (found != m_allocations.end())
+	{
+		m_currentBytes -= found->second.bytes;
+		m_allocations.erase(found);
+	}
+}
+
+void GpuMemoryTracker::release(GpuResourceKind kind, const unsigned int* ids, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		release(kind, ids[i]);
+	}
+}
+
+uint64_t GpuMemoryTracker::textureBytes(int width, int height, int layers, int bytesPerTexel, bool mipmapped)
+{
+	const uint64_t base = static_cast<uint64_t>(width) * height * layers * bytesPerTexel;
+	return mipmapped ? base * 4 / 3 : base;
+}
+
+GpuMemoryTotals GpuMemoryTracker::getTotals() const
+{
+	GpuMemoryTotals totals;
+	std::map<std::string, uint64_t> tags;
+	for (const auto& entry : m_allocations)
+	{
+		const size_t kind = static_cast<size_t>(entry.second.kind);
+		totals.bytes[kind] += entry.second.bytes;
+		totals.objects[kind]++;
+		tags[entry.second.tag] += entry.second.bytes;
+	}
+
+	totals.byTag.assign(tags.begin(), tags.end());
+	std::sort(totals.byTag.begin(), totals.byTag.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+	return totals;
+}
+
+void GpuMemoryTracker::queryDriver()
+{
+	if (m_driverExtension == 0)
+	{
+		m_driverExtension = 3;
+		GLint count = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+		for (GLint i = 0; i < count; i++)
+		{
+			const char* name = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+			if (std::strcmp(name, "GL_NVX_gpu_memory_info") == 0)
+			{
+				m_driverExtension = 1;
+				break;
+			}
+			if (std::strcmp(name, "GL_ATI_meminfo") == 0)
+			{
+				m_driverExtension = 2;
+			}
+		}
+	}
+
+	if (m_driverExtension == 1)
+	{
+		GLint total = 0;
+		GLint available = 0;
+		glGetIntegerv(GL_GPU_MEMORY_INFO_TOTAL_AVAILABLE_MEMORY_NVX, &total);
+		glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, &available);
+		m_driver = { "NVX_gpu_memory_info", total, available };
+	}
+	else if (m_driverExtension == 2)
+	{
+		//Free pool size, largest free block, free auxiliary memory, largest auxiliary block
+		GLint info[4] = {};
+		glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, info);
+		m_driver = { "ATI_meminfo", -1, info[0] };
+	}
+}
+
+void GpuMemoryTracker::writeReport(std::ostream& out) const
+{
+	const GpuMemoryTotals totals = getTotals();
+	out << "GPU memory report\n";
+	out << "Current: " << m_currentBytes / 1024 << " KB, peak: " << m_peakBytes / 1024 << " KB\n";
+	for (size_t kind = 0; kind < static_cast<size_t>(GpuResourceKind::COUNT); kind++)
+	{
+		out << KIND_NAMES[kind] << ": " << totals.objects[kind] << " objects, " << totals.bytes[kind] / 1024 << " KB\n";
+	}
+
+	out << "\nBy owner\n";
+	for (const auto& tag : totals.byTag)
+	{
+		out << "  " << std::left << std::setw(24) << tag.first << tag.second / 1024 << " KB\n";
+	}
+
+	std::vector<const Allocation*> live;
+	for (const auto& entry : m_allocations)
+	{
+		live.push_back(&entry.second);
+	}
+	std::sort(live.begin(), live.end(), [](const Allocation* a, const Allocation* b) { return a->bytes > b->bytes; });
+
+	out << "\nLive objects (leaks when written at exit)\n";
+	for (const Allocation* allocation : live)
+	{
+		out << "  " << std::left << std::setw(14) << KIND_NAMES[static_cast<size_t>(allocation->kind)]
+			<< std::setw(8) << allocation->id << std::setw(24) << allocation->tag << std::setw(20) << allocation->format
+			<< std::right << std::setw(10) << allocation->bytes / 1024 << " KB  frame " << allocation->frame << "\n";
+	}
+}
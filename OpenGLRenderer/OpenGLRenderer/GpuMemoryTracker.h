@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum class GpuResourceKind : uint32_t
+{
+	BUFFER = 0,
+	TEXTURE = 1,
+	RENDERBUFFER = 2,
+	COUNT = 3
+};
+
+struct GpuMemoryTotals
+{
+	uint64_t bytes[static_cast<size_t>(GpuResourceKind::COUNT)] = {};
+	uint32_t objects[static_cast<size_t>(GpuResourceKind::COUNT)] = {};
+	//Bytes per owner tag, largest first
+	std::vector<std::pair<std::string, uint64_t>> byTag;
+};
+
+struct GpuDriverMemory
+{
+	//NVX or ATI, nullptr when neither extension is exposed
+	const char* source = nullptr;
+	//Kilobytes, -1 where the extension does not report the value
+	int64_t totalKB = -1;
+	int64_t availableKB = -1;
+};
+
+//Bookkeeping of GL object memory. Allocation sites report each buffer, texture and renderbuffer with
+//its estimated size, format and owner tag; deletion sites release it. Sizes are computed from the
+//requested dimensions and format, drivers may pad or compress. Objects still tracked when the
+//tracker is destroyed after main returns are reported as leaks in gpu_memory_report.txt.
+class GpuMemoryTracker
+{
+public:
+	static GpuMemoryTracker& get();
+
+	GpuMemoryTracker(const GpuMemoryTracker& other) = delete;
+	~GpuMemoryTracker();
+
+	//Records an allocation, or replaces the size of an already tracked object on reallocation.
+	//format and tag must outlive the tracker, string literals in practice
+	void allocate(GpuResourceKind kind, unsigned int id, uint64_t bytes, const char* format, const char* tag);
+	void release(GpuResourceKind kind, unsigned int id);
+	void release(GpuResourceKind kind, const unsigned int* ids, int count);
+
+	//Frame counter used as allocation time in the report
+	void beginFrame()
+	{
+		m_frame++;
+	}
+
+	//Size of a texture with the given texel size, a full mip chain adds a third
+	static uint64_t textureBytes(int width, int height, int layers, int bytesPerTexel, bool mipmapped);
+
+	[[nodiscard]] GpuMemoryTotals getTotals() const;
+
+	[[nodiscard]] uint64_t getCurrentBytes() const
+	{
+		return m_currentBytes;
+	}
+
+	[[nodiscard]] uint64_t getPeakBytes() const
+	{
+		return m_peakBytes;
+	}
+
+	//Reads the driver's memory counters, requires a current context
+	void queryDriver();
+
+	[[nodiscard]] const GpuDriverMemory& getDriverMemory() const
+	{
+		return m_driver;
+	}
+
+	void writeReport(std::ostream& out) const;
+
+private:
+	struct Allocation
+	{
+		GpuResourceKind	kind;
+		unsigned int	id;
+		uint64_t		bytes;
+		const char*		format;
+		const char*		tag;
+		uint64_t		frame;
+	};
+
+	std::unordered_map<uint64_t, Allocation>	m_allocations;
+	uint64_t									m_frame = 0;
+	uint64_t									m_peakBytes = 0;
+	uint64_t									m_currentBytes = 0;
+
+	GpuDriverMemory								m_driver;
+	//0 unknown, 1 NVX, 2 ATI, 3 none
+	int											m_driverExtension = 0;
+
+	GpuMemoryTracker() = default;
+
+	static uint64_t makeKey(GpuResourceKind kind, unsigned int id)
+	{
+		return (static_cast<uint64_t>(kind) << 32) | id;
+	}
+};
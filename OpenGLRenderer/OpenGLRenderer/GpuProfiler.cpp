@@ -0,0 +1,119 @@
+#include "GpuProfiler.h"
+
+#include <iostream>
+
+#include "GLExtensions.h"
+
+GpuProfiler::GpuProfiler()
+{
+	for (FrameSlot& slot : m_slots)
+	{
+		glGenQueries(MAX_PASSES, slot.queries);
+	}
+}
+
+GpuProfiler::~GpuProfiler()
+{
+	for (FrameSlot& slot : m_slots)
+	{
+		glDeleteQueries(MAX_PASSES, slot.queries);
+	}
+}
+
+void GpuProfiler::beginFrame()
+{
+	FrameSlot& slot = m_slots[m_slot];
+	resolve(slot);
+	slot.used = 0;
+	slot.frame = m_frame++;
+}
+
+void GpuProfiler::endFrame()
+{
+	if (m_passOpen)
+	{
+		std::cout << "ERROR::GPU_PROFILER::PASS_NOT_ENDED" << std::endl;
+		endPass();
+	}
+	m_slot = (m_slot + 1) % FRAME_LATENCY;
+}
+
+void GpuProfiler::beginPass(const char* name)
+{
+	FrameSlot& slot = m_slots[m_slot];
+	if (m_passOpen || slot.used == MAX_PASSES)
+	{
+		std::cout << "ERROR::GPU_PROFILER::CANNOT_BEGIN_PASS " << name << std::endl;
+		return;
+	}
+
+	slot.passes[slot.used] = findPass(name);
+	glBeginQuery(GL_TIME_ELAPSED, slot.queries[slot.used]);
+	m_passOpen = true;
+}
+
+void GpuProfiler::endPass()
+{
+	if (!m_passOpen)
+	{
+		return;
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	m_slots[m_slot].used++;
+	m_passOpen = false;
+}
+
+int GpuProfiler::findPass(const char* name)
+{
+	for (size_t i = 0; i < m_timings.size(); i++)
+	{
+		if (m_timings[i].name == name)
+		{
+			return static_cast<int>(i);
+		}
+	}
+
+	GpuPassTiming timing;
+	timing.name = name;
+	m_timings.push_back(timing);
+	m_history.emplace_back();
+	return static_cast<int>(m_timings.size() - 1);
+}
+
+void GpuProfiler::resolve(FrameSlot& slot)
+{
+	if (slot.used == 0)
+	{
+		return;
+	}
+
+	//Queries complete in order, so the last one being available covers the whole frame
+	GLint available = 0;
+	glGetQueryObjectiv(slot.queries[slot.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		m_droppedFrames++;
+		return;
+	}
+
+	m_frameMs = 0.0f;
+	m_resolvedFrame = slot.frame;
+	for (int i = 0; i < slot.used; i++)
+	{
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(slot.queries[i], GL_QUERY_RESULT, &elapsed);
+		const float ms = static_cast<float>(elapsed) / 1000000.0f;
+		m_frameMs += ms;
+
+		const int pass = slot.passes[i];
+		PassHistory& history = m_history[pass];
+		history.sum += ms - history.samples[history.next];
+		history.samples[history.next] = ms;
+		history.next = (history.next + 1) % AVERAGE_FRAMES;
+		history.count = history.count < AVERAGE_FRAMES ? history.count + 1 : AVERAGE_FRAMES;
+
+		m_timings[pass].lastMs = ms;
+		m_timings[pass].averageMs = history.sum / static_cast<float>(history.count);
+		m_timings[pass].frame = slot.frame;
+	}
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct GpuPassTiming
+{
+	std::string name;
+	float lastMs = 0.0f;
+	//Mean over the last AVERAGE_FRAMES resolved frames
+	float averageMs = 0.0f;
+	//Frame lastMs was measured in, -1 before the first result
+	int64_t frame = -1;
+};
+
+//GPU time per render pass from GL_TIME_ELAPSED queries. Every frame takes its queries from one slot
+//of a ring of FRAME_LATENCY slots and reads them back when the slot comes around again, so results
+//arrive FRAME_LATENCY - 1 frames late without waiting on the GPU. A slot that is still not available
+//by then is dropped instead of stalling. Time elapsed queries cannot nest, passes are sequential.
+class GpuProfiler
+{
+public:
+	static constexpr int FRAME_LATENCY = 4;
+	static constexpr int MAX_PASSES = 16;
+	static constexpr int AVERAGE_FRAMES = 60;
+
+	GpuProfiler();
+	GpuProfiler(const GpuProfiler& other) = delete;
+	~GpuProfiler();
+
+	//Resolves the slot about to be reused, call once before the first pass
+	void beginFrame();
+	void endFrame();
+
+	//Passes are identified by name, the table keeps the order they were first seen in
+	void beginPass(const char* name);
+	void endPass();
+
+	//Passes in submission order
+	[[nodiscard]] const std::vector<GpuPassTiming>& getTimings() const
+	{
+		return m_timings;
+	}
+
+	[[nodiscard]] float getFrameMs() const
+	{
+		return m_frameMs;
+	}
+
+	//Index of the frame the current results belong to, counted by beginFrame from 0, -1 before any
+	[[nodiscard]] int64_t getResolvedFrame() const
+	{
+		return m_resolvedFrame;
+	}
+
+	//Frames whose queries were not available after FRAME_LATENCY frames
+	[[nodiscard]] uint32_t getDroppedFrames() const
+	{
+		return m_droppedFrames;
+	}
+
+private:
+	struct PassHistory
+	{
+		float		samples[AVERAGE_FRAMES] = {};
+		float		sum = 0.0f;
+		int			next = 0;
+		int			count = 0;
+	};
+
+	struct FrameSlot
+	{
+		unsigned int	queries[MAX_PASSES] = {};
+		int				passes[MAX_PASSES] = {};
+		int				used = 0;
+		int64_t			frame = -1;
+	};
+
+	FrameSlot						m_slots[FRAME_LATENCY];
+	int								m_slot = 0;
+	int64_t							m_frame = 0;
+	int64_t							m_resolvedFrame = -1;
+	bool							m_passOpen = false;
+
+	std::vector<GpuPassTiming>		m_timings;
+	std::vector<PassHistory>		m_history;
+	float							m_frameMs = 0.0f;
+	uint32_t						m_droppedFrames = 0;
+
+	int findPass(const char* name);
+	void resolve(FrameSlot& slot);
+};
@@ -0,0 +1,164 @@
+#include "GpuVegetation.h"
+
+#include "GpuMemoryTracker.h"
+#include "RenderStats.h"
+
+namespace
+{
+	constexpr unsigned int SCATTER_GROUP_SIZE = 64;
+
+	//Matches the std430 Triangle struct in GrassScatter.comp
+	struct ScatterTriangle
+	{
+		glm::vec4 p0;
+		glm::vec4 p1;
+		glm::vec4 p2;
+		glm::vec4 uv01;
+		glm::vec4 uv2Cdf;
+	};
+}
+
+GpuVegetation::GpuVegetation(Entity& terrain, Model& grass, unsigned int densityMap, const GpuVegetationSettings& settings)
+	: m_grass(grass), m_settings(settings), m_densityMap(densityMap)
+{
+	m_scatterShader = std::make_unique<Shader>("Shaders/GrassScatter.comp");
+
+	//Bounding sphere around the instance origin, scaled per instance in the shader
+	const AABB& bounds = grass.getBounds();
+	m_boundingRadius = glm::length(bounds.getCenter()) + glm::length(bounds.getExtents());
+
+	uploadTerrain(terrain);
+
+	//Instance matrices are written by the compute pass and read as vertex attributes
+	glGenBuffers(1, &m_instanceSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_instanceSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, static_cast<size_t>(m_settings.candidateCount) * sizeof(glm::mat4), nullptr, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, m_instanceSSBO,
+		static_cast<size_t>(m_settings.candidateCount) * sizeof(glm::mat4), "mat4", "GpuVegetation");
+	m_grass.setupInstanceAttributes(m_instanceSSBO);
+
+	//One command per grass mesh, the compute pass fills in instanceCount
+	for (const auto& mesh : grass.getMeshes())
+	{
+		m_resetCommands.push_back({ static_cast<GLuint>(mesh.getIndices().size()), 0, 0, 0, 0 });
+	}
+
+	glGenBuffers(1, &m_commandBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, m_resetCommands.size() * sizeof(DrawElementsIndirectCommand), m_resetCommands.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, m_commandBuffer,
+		m_resetCommands.size() * sizeof(DrawElementsIndirectCommand), "DrawElementsIndirectCommand", "GpuVegetation");
+}
+
+GpuVegetation::~GpuVegetation()
+{
+	glDeleteBuffers(1, &m_triangleSSBO);
+	glDeleteBuffers(1, &m_instanceSSBO);
+	glDeleteBuffers(1, &m_commandBuffer);
+
+	GpuMemoryTracker& tracker = GpuMemoryTracker::get();
+	tracker.release(GpuResourceKind::BUFFER, m_triangleSSBO);
+	tracker.release(GpuResourceKind::BUFFER, m_instanceSSBO);
+	tracker.release(GpuResourceKind::BUFFER, m_commandBuffer);
+}
+
+void GpuVegetation::cull(const Frustum& frustum, const glm::vec3& viewPos)
+{
+	if (m_triangleCount == 0)
+	{
+		return;
+	}
+
+	//Reset instance counters
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, m_resetCommands.size() * sizeof(DrawElementsIndirectCommand), m_resetCommands.data());
+	RenderStats::current().bytesUploaded += m_resetCommands.size() * sizeof(DrawElementsIndirectCommand);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	m_scatterShader->use();
+	m_scatterShader->setUint("_CandidateCount", m_settings.candidateCount);
+	m_scatterShader->setUint("_TriangleCount", m_triangleCount);
+	m_scatterShader->setUint("_MeshCount", static_cast<unsigned int>(m_resetCommands.size()));
+	m_scatterShader->setUint("_Seed", m_settings.seed);
+	m_scatterShader->setFloat("_MaxDistance", m_settings.maxDistance);
+	m_scatterShader->setVec2("_ScaleRange", m_settings.minScale, m_settings.maxScale);
+	m_scatterShader->setFloat("_BoundingRadius", m_boundingRadius);
+	m_scatterShader->setVec3("_ViewPos", viewPos);
+	for (int i = 0; i < Frustum::PLANE_COUNT; i++)
+	{
+		m_scatterShader->setVec4("_FrustumPlanes[" + std::to_string(i) + "]", frustum.getPlane(i));
+	}
+
+	m_scatterShader->setBool("_HasDensityMap", m_densityMap != 0);
+	m_scatterShader->setInt("_DensityMap", 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_densityMap);
+	RenderStats::current().textureBinds++;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_triangleSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_instanceSSBO);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_commandBuffer);
+
+	glDispatchCompute((m_settings.candidateCount + SCATTER_GROUP_SIZE - 1) / SCATTER_GROUP_SIZE, 1, 1);
+
+	//Instance data is consumed as vertex attributes and the counters as draw commands
+	glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
+
+void GpuVegetation::Draw(Shader& shader)
+{
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	m_grass.DrawIndirect(shader);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GpuVegetation::uploadTerrain(Entity& terrain)
+{
+	std::vector<ScatterTriangle> triangles;
+	const glm::mat4& model = terrain.transform.getRenderMatrix();
+
+	float totalArea = 0.0f;
+	for (const auto& mesh : terrain.getMeshes())
+	{
+		const auto& vertices = mesh.getVertices();
+		const auto& indices = mesh.getIndices();
+		for (size_t i = 0; i + 2 < indices.size(); i += 3)
+		{
+			const Vertex& v0 = vertices[indices[i]];
+			const Vertex& v1 = vertices[indices[i + 1]];
+			const Vertex& v2 = vertices[indices[i + 2]];
+
+			ScatterTriangle tri;
+			tri.p0 = model * glm::vec4(v0.position, 1.0f);
+			tri.p1 = model * glm::vec4(v1.position, 1.0f);
+			tri.p2 = model * glm::vec4(v2.position, 1.0f);
+			tri.uv01 = glm::vec4(v0.texCoord, v1.texCoord);
+
+			//Running area total, normalized below into a CDF for area weighted picking
+			totalArea += 0.5f * glm::length(glm::cross(glm::vec3(tri.p1 - tri.p0), glm::vec3(tri.p2 - tri.p0)));
+			tri.uv2Cdf = glm::vec4(v2.texCoord, totalArea, 0.0f);
+
+			triangles.push_back(tri);
+		}
+	}
+
+	if (triangles.empty() || totalArea <= 0.0f)
+	{
+		std::cout << "ERROR::VEGETATION::TERRAIN_HAS_NO_TRIANGLES" << std::endl;
+		return;
+	}
+
+	for (auto& tri : triangles)
+	{
+		tri.uv2Cdf.z /= totalArea;
+	}
+
+	m_triangleCount = static_cast<unsigned int>(triangles.size());
+	glGenBuffers(1, &m_triangleSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_triangleSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, triangles.size() * sizeof(ScatterTriangle), triangles.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, m_triangleSSBO, triangles.size() * sizeof(ScatterTriangle), "ScatterTriangle", "GpuVegetation");
+}
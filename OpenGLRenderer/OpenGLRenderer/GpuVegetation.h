@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+
+#include "Entity.h"
+#include "Frustum.h"
+#include "GLExtensions.h"
+#include "Shader.h"
+
+struct GpuVegetationSettings
+{
+	unsigned int candidateCount = 65536;
+	float maxDistance = 60.0f;
+	float minScale = 0.6f;
+	float maxScale = 1.2f;
+	unsigned int seed = 1337;
+};
+
+//GPU driven grass: a compute pass scatters candidates over the terrain triangles weighted by area,
+//rejects them by the density map, distance and frustum, and appends survivors to an instance buffer
+//and indirect draw commands. Requires GL 4.3, see GLExtensions::hasGL43().
+class GpuVegetation
+{
+public:
+	//densityMap may be 0 for uniform density
+	GpuVegetation(Entity& terrain, Model& grass, unsigned int densityMap, const GpuVegetationSettings& settings);
+	GpuVegetation(const GpuVegetation& other) = delete;
+	~GpuVegetation();
+
+	void cull(const Frustum& frustum, const glm::vec3& viewPos);
+	void Draw(Shader& shader);
+
+private:
+	Model&					m_grass;
+	GpuVegetationSettings	m_settings;
+	unsigned int			m_densityMap;
+	float					m_boundingRadius;
+
+	std::unique_ptr<Shader>	m_scatterShader;
+	unsigned int			m_triangleCount = 0;
+	unsigned int			m_triangleSSBO = 0;
+	unsigned int			m_instanceSSBO = 0;
+	unsigned int			m_commandBuffer = 0;
+
+	std::vector<DrawElementsIndirectCommand> m_resetCommands;
+
+	void uploadTerrain(Entity& terrain);
+};
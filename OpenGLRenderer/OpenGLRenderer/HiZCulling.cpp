@@ -0,0 +1,377 @@
+#include "HiZCulling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "CpuProfiler.h"
+#include "GpuMemoryTracker.h"
+#include "RenderStats.h"
+
+namespace
+{
+	constexpr unsigned int CULL_GROUP_SIZE = 64;
+	//Widest mip read back for the CPU path
+	constexpr int READBACK_MAX_WIDTH = 256;
+}
+
+HiZCulling::HiZCulling(int width, int height)
+	: m_width(width), m_height(height), m_useCompute(GLExtensions::hasGL43())
+{
+	m_mipCount = 1 + static_cast<int>(std::floor(std::log2(static_cast<float>(std::max(width, height)))));
+
+	glGenTextures(1, &m_pyramid);
+	glBindTexture(GL_TEXTURE_2D, m_pyramid);
+	int mipWidth = width;
+	int mipHeight = height;
+	uint64_t pyramidBytes = 0;
+	for (int level = 0; level < m_mipCount; level++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, mipWidth, mipHeight, 0, GL_RED, GL_FLOAT, nullptr);
+		pyramidBytes += GpuMemoryTracker::textureBytes(mipWidth, mipHeight, 1, sizeof(float), false);
+
+		if (m_readbackMip == 0 && mipWidth <= READBACK_MAX_WIDTH)
+		{
+			m_readbackMip = level;
+			m_readbackWidth = mipWidth;
+			m_readbackHeight = mipHeight;
+		}
+
+		mipWidth = std::max(1, mipWidth / 2);
+		mipHeight = std::max(1, mipHeight / 2);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_mipCount - 1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, m_pyramid, pyramidBytes, "R32F", "HiZCulling");
+
+	glGenFramebuffers(1, &m_FBO);
+	glGenVertexArrays(1, &m_emptyVAO);
+	glGenQueries(2, m_timerQueries);
+
+	m_buildShader = std::make_unique<Shader>("Shaders/HiZBuild.vs", "Shaders/HiZBuild.fs");
+
+	if (m_useCompute)
+	{
+		m_cullShader = std::make_unique<Shader>("Shaders/HiZCull.comp");
+
+		const GLuint zero = 0;
+		for (StatsSlot& slot : m_statsSlots)
+		{
+			glGenBuffers(1, &slot.buffer);
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), &zero, GL_DYNAMIC_READ);
+			GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, slot.buffer, sizeof(GLuint), "uint32", "HiZCulling");
+		}
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+	else
+	{
+		glGenBuffers(1, &m_readbackPBO);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackPBO);
+		glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<size_t>(m_readbackWidth) * m_readbackHeight * sizeof(float), nullptr, GL_STREAM_READ);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, m_readbackPBO,
+			static_cast<size_t>(m_readbackWidth) * m_readbackHeight * sizeof(float), "R32F", "HiZCulling");
+	}
+}
+
+HiZCulling::~HiZCulling()
+{
+	if (m_readbackFence)
+	{
+		glDeleteSync(m_readbackFence);
+	}
+
+	glDeleteTextures(1, &m_pyramid);
+	glDeleteFramebuffers(1, &m_FBO);
+	glDeleteVertexArrays(1, &m_emptyVAO);
+	glDeleteQueries(2, m_timerQueries);
+	for (StatsSlot& slot : m_statsSlots)
+	{
+		if (slot.fence)
+		{
+			glDeleteSync(slot.fence);
+		}
+		glDeleteBuffers(1, &slot.buffer);
+		GpuMemoryTracker::get().release(GpuResourceKind::BUFFER, slot.buffer);
+	}
+	glDeleteBuffers(1, &m_readbackPBO);
+	GpuMemoryTracker::get().release(GpuResourceKind::TEXTURE, m_pyramid);
+	GpuMemoryTracker::get().release(GpuResourceKind::BUFFER, m_readbackPBO);
+}
+
+void HiZCulling::build(unsigned int depthTexture, const glm::mat4& worldToClip)
+{
+	//Timing of the previous build, skipped if the GPU has not caught up yet
+	if (m_timerStarted)
+	{
+		const unsigned int previousQuery = m_timerQueries[m_timerFrame ^ 1];
+		GLint available = 0;
+		glGetQueryObjectiv(previousQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available)
+		{
+			GLuint64 elapsed = 0;
+			glGetQueryObjectui64v(previousQuery, GL_QUERY_RESULT, &elapsed);
+			m_stats.buildMs = static_cast<float>(elapsed) / 1000000.0f;
+		}
+	}
+
+	glBeginQuery(GL_TIME_ELAPSED, m_timerQueries[m_timerFrame]);
+	m_timerStarted = true;
+
+	GLint previousFBO = 0;
+	GLint previousViewport[4];
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFBO);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	const GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+	const GLboolean blend = glIsEnabled(GL_BLEND);
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glDisable(GL_BLEND);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+	RenderStats::current().fboSwitches++;
+	glBindVertexArray(m_emptyVAO);
+	m_buildShader->use();
+	m_buildShader->setInt("_Source", 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	int sourceWidth = m_width;
+	int sourceHeight = m_height;
+	for (int level = 0; level < m_mipCount; level++)
+	{
+		const int targetWidth = level == 0 ? m_width : std::max(1, sourceWidth / 2);
+		const int targetHeight = level == 0 ? m_height : std::max(1, sourceHeight / 2);
+
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_pyramid, level);
+		glViewport(0, 0, targetWidth, targetHeight);
+
+		if (level == 0)
+		{
+			glBindTexture(GL_TEXTURE_2D, depthTexture);
+			m_buildShader->setBool("_Downsample", false);
+			m_buildShader->setInt("_SourceLevel", 0);
+		}
+		else
+		{
+			//Restrict sampling to the source level so the written level is never read
+			glBindTexture(GL_TEXTURE_2D, m_pyramid);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+			m_buildShader->setBool("_Downsample", true);
+			m_buildShader->setInt("_SourceLevel", level - 1);
+		}
+		m_buildShader->setIVec2("_SourceSize", sourceWidth, sourceHeight);
+
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		RenderStats::current().textureBinds++;
+		RenderStats::current().addDraw(3);
+
+		sourceWidth = targetWidth;
+		sourceHeight = targetHeight;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, m_pyramid);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, m_mipCount - 1);
+
+	//CPU path, start an async copy of a low mip unless the previous one is still in flight
+	if (!m_useCompute && !m_readbackFence)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackPBO);
+		glGetTexImage(GL_TEXTURE_2D, m_readbackMip, GL_RED, GL_FLOAT, nullptr);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		m_readbackFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		m_readbackWorldToClip = worldToClip;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindVertexArray(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFBO);
+	RenderStats::current().fboSwitches++;
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	if (depthTest)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	if (cullFace)
+	{
+		glEnable(GL_CULL_FACE);
+	}
+	if (blend)
+	{
+		glEnable(GL_BLEND);
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+	m_timerFrame ^= 1;
+
+	m_pyramidWorldToClip = worldToClip;
+	m_hasPyramid = true;
+}
+
+void HiZCulling::cullCommands(const StaticGeometry& geometry)
+{
+	PROFILE_SCOPE("HiZCulling::cullCommands");
+	if (!m_useCompute)
+	{
+		return;
+	}
+
+	StatsSlot& slot = m_statsSlots[m_statsSlot];
+	readStats(slot);
+
+	const unsigned int commandCount = geometry.getCommandCount();
+	if (!m_hasPyramid || commandCount == 0)
+	{
+		return;
+	}
+
+	m_cullShader->use();
+	m_cullShader->setUint("_CommandCount", commandCount);
+	m_cullShader->setMat4("_WorldToClip", m_pyramidWorldToClip);
+	m_cullShader->setVec2("_PyramidSize", static_cast<float>(m_width), static_cast<float>(m_height));
+	m_cullShader->setInt("_MaxMip", m_mipCount - 1);
+	m_cullShader->setInt("_HiZ", 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_pyramid);
+	RenderStats::current().textureBinds++;
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, geometry.getDrawDataBuffer());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, geometry.getCommandBuffer());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, slot.buffer);
+
+	glDispatchCompute((commandCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+
+	//Zeroed instance counts are consumed as draw commands, the counter is read when the slot comes around
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.tested = commandCount;
+	m_statsSlot = (m_statsSlot + 1) % STATS_LATENCY;
+}
+
+void HiZCulling::cull(std::vector<Entity*>& entities)
+{
+	PROFILE_SCOPE("HiZCulling::cull");
+	if (m_useCompute)
+	{
+		return;
+	}
+
+	//Pick up a finished readback without waiting on the GPU
+	if (m_readbackFence && glClientWaitSync(m_readbackFence, 0, 0) != GL_TIMEOUT_EXPIRED)
+	{
+		glDeleteSync(m_readbackFence);
+		m_readbackFence = nullptr;
+
+		m_cpuDepth.resize(static_cast<size_t>(m_readbackWidth) * m_readbackHeight);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackPBO);
+		const void* data = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+		if (data)
+		{
+			std::memcpy(m_cpuDepth.data(), data, m_cpuDepth.size() * sizeof(float));
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			m_cpuWorldToClip = m_readbackWorldToClip;
+			m_hasCpuDepth = true;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	m_stats.tested = static_cast<uint32_t>(entities.size());
+	m_stats.culled = 0;
+	if (!m_hasCpuDepth)
+	{
+		return;
+	}
+
+	auto occluded = std::remove_if(entities.begin(), entities.end(), [this](const Entity* entity)
+	{
+		return isOccludedCPU(entity->getWorldBounds());
+	});
+	m_stats.culled = static_cast<uint32_t>(std::distance(occluded, entities.end()));
+	entities.erase(occluded, entities.end());
+}
+
+void HiZCulling::readStats(StatsSlot& slot)
+{
+	if (!slot.fence)
+	{
+		return;
+	}
+
+	//Still in flight after STATS_LATENCY frames, drop its counts instead of stalling
+	const GLenum status = glClientWaitSync(slot.fence, 0, 0);
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+
+	GLuint culled = 0;
+	const GLuint zero = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, slot.buffer);
+	if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+	{
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &culled);
+		m_stats.tested = slot.tested;
+		m_stats.culled = culled;
+	}
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+	RenderStats::current().bytesUploaded += sizeof(GLuint);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+bool HiZCulling::isOccludedCPU(const AABB& bounds) const
+{
+	glm::vec2 uvMin(1.0f);
+	glm::vec2 uvMax(0.0f);
+	float minDepth = 1.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		const glm::vec3 corner((i & 1) ? bounds.max.x : bounds.min.x,
+							   (i & 2) ? bounds.max.y : bounds.min.y,
+							   (i & 4) ? bounds.max.z : bounds.min.z);
+		const glm::vec4 clip = m_cpuWorldToClip * glm::vec4(corner, 1.0f);
+
+		//Crossing the near plane, keep it
+		if (clip.w <= 0.0f)
+		{
+			return false;
+		}
+
+		const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		uvMin = glm::min(uvMin, glm::vec2(ndc) * 0.5f + 0.5f);
+		uvMax = glm::max(uvMax, glm::vec2(ndc) * 0.5f + 0.5f);
+		minDepth = std::min(minDepth, ndc.z * 0.5f + 0.5f);
+	}
+
+	if (uvMin.x > 1.0f || uvMin.y > 1.0f || uvMax.x < 0.0f || uvMax.y < 0.0f)
+	{
+		return false;
+	}
+
+	const int x0 = std::clamp(static_cast<int>(uvMin.x * m_readbackWidth), 0, m_readbackWidth - 1);
+	const int y0 = std::clamp(static_cast<int>(uvMin.y * m_readbackHeight), 0, m_readbackHeight - 1);
+	const int x1 = std::clamp(static_cast<int>(uvMax.x * m_readbackWidth), 0, m_readbackWidth - 1);
+	const int y1 = std::clamp(static_cast<int>(uvMax.y * m_readbackHeight), 0, m_readbackHeight - 1);
+
+	//Occluded only if every covered texel is nearer than the closest point of the box
+	for (int y = y0; y <= y1; y++)
+	{
+		for (int x = x0; x <= x1; x++)
+		{
+			if (minDepth <= m_cpuDepth[static_cast<size_t>(y) * m_readbackWidth + x])
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Entity.h"
+#include "Frustum.h"
+#include "GLExtensions.h"
+#include "Shader.h"
+#include "StaticGeometry.h"
+
+//Hierarchical-Z occlusion culling against the previous frame's depth buffer.
+//The pyramid stores the farthest depth of each texel footprint. Bounds are projected with the
+//matching previous frame view projection, so newly revealed objects can lag by one frame.
+//With GL 4.3 a compute pass zeroes instanceCount of occluded StaticGeometry commands on the GPU;
+//otherwise a low mip is read back asynchronously and entities are tested on the CPU.
+class HiZCulling
+{
+public:
+	HiZCulling(int width, int height);
+	HiZCulling(const HiZCulling& other) = delete;
+	~HiZCulling();
+
+	//Builds the pyramid from the current frame's depth, call after opaque geometry is drawn
+	void build(unsigned int depthTexture, const glm::mat4& worldToClip);
+
+	//GPU path: culls commands prepared by StaticGeometry::prepare
+	void cullCommands(const StaticGeometry& geometry);
+	//CPU path: removes occluded entities from the list in place
+	void cull(std::vector<Entity*>& entities);
+
+	//Counts for the latest frame the GPU finished, up to STATS_LATENCY frames late on the GPU path
+	[[nodiscard]] const OcclusionStats& getStats() const
+	{
+		return m_stats;
+	}
+
+private:
+	int								m_width;
+	int								m_height;
+	int								m_mipCount;
+	bool							m_useCompute;
+	bool							m_hasPyramid = false;
+	glm::mat4						m_pyramidWorldToClip = glm::mat4(1.0f);
+
+	unsigned int					m_pyramid = 0;
+	unsigned int					m_FBO = 0;
+	unsigned int					m_emptyVAO = 0;
+	std::unique_ptr<Shader>			m_buildShader;
+	std::unique_ptr<Shader>			m_cullShader;
+
+	//GPU path counters in a ring of STATS_LATENCY buffers, each read once its fence signalled
+	static constexpr int STATS_LATENCY = 3;
+	struct StatsSlot
+	{
+		unsigned int	buffer = 0;
+		GLsync			fence = nullptr;
+		uint32_t		tested = 0;
+	};
+	StatsSlot						m_statsSlots[STATS_LATENCY];
+	int								m_statsSlot = 0;
+
+	//CPU path readback of a low mip
+	int								m_readbackMip = 0;
+	int								m_readbackWidth = 0;
+	int								m_readbackHeight = 0;
+	unsigned int					m_readbackPBO = 0;
+	GLsync							m_readbackFence = nullptr;
+	glm::mat4						m_readbackWorldToClip = glm::mat4(1.0f);
+	std::vector<float>				m_cpuDepth;
+	glm::mat4						m_cpuWorldToClip = glm::mat4(1.0f);
+	bool							m_hasCpuDepth = false;
+
+	unsigned int					m_timerQueries[2] = { 0, 0 };
+	int								m_timerFrame = 0;
+	//The query of the previous frame only exists once build() ran
+	bool							m_timerStarted = false;
+
+	OcclusionStats					m_stats;
+
+	void readStats(StatsSlot& slot);
+	bool isOccludedCPU(const AABB& bounds) const;
+};
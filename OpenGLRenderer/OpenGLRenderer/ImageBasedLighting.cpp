@@ -0,0 +1,380 @@
+#include "ImageBasedLighting.h"
+
+#include <array>
+#include <fstream>
+#include <iterator>
+
+#include "GpuMemoryTracker.h"
+#include "RenderStats.h"
+
+namespace
+{
+	//Bump when any of the precompute shaders or map sizes change
+	constexpr uint32_t IBL_CACHE_VERSION = 1;
+	constexpr uint32_t IBL_CACHE_MAGIC = 0x4C424931; // "1IBL"
+
+	struct CacheHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t size;
+		uint32_t levels;
+		uint32_t faces;
+		uint32_t channels;
+	};
+
+	const glm::mat4 captureProjection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+	const std::array<glm::mat4, 6> captureViews =
+	{
+		glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+		glm::lookAt(glm::vec3(0.0f), glm::vec3(-1.0f, 0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+		glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,  1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f)),
+		glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f, -1.0f)),
+		glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)),
+		glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f))
+	};
+
+	GLenum channelsToFormat(uint32_t channels)
+	{
+		return channels == 2 ? GL_RG : GL_RGB;
+	}
+
+	bool readTexture(const std::filesystem::path& file, GLenum target, uint32_t texture,
+					 uint32_t size, uint32_t levels, uint32_t faces, uint32_t channels)
+	{
+		std::ifstream in(file, std::ios::binary);
+		if (!in)
+		{
+			return false;
+		}
+
+		CacheHeader header{};
+		in.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!in || header.magic != IBL_CACHE_MAGIC || header.version != IBL_CACHE_VERSION ||
+			header.size != size || header.levels != levels || header.faces != faces || header.channels != channels)
+		{
+			return false;
+		}
+
+		glBindTexture(target, texture);
+		std::vector<float> data;
+		for (uint32_t mip = 0; mip < levels; mip++)
+		{
+			const uint32_t mipSize = size >> mip;
+			data.resize(static_cast<size_t>(mipSize) * mipSize * channels);
+			for (uint32_t face = 0; face < faces; face++)
+			{
+				in.read(reinterpret_cast<char*>(data.data()), data.size() * sizeof(float));
+				if (!in)
+				{
+					return false;
+				}
+
+				const GLenum faceTarget = faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+				glTexSubImage2D(faceTarget, mip, 0, 0, mipSize, mipSize, channelsToFormat(channels), GL_FLOAT, data.data());
+			}
+		}
+
+		return true;
+	}
+
+	void writeTexture(const std::filesystem::path& file, GLenum target, uint32_t texture,
+					  uint32_t size, uint32_t levels, uint32_t faces, uint32_t channels)
+	{
+		std::ofstream out(file, std::ios::binary);
+		if (!out)
+		{
+			std::cout << "ERROR::IBL::CACHE_WRITE_FAILED " << file.generic_string() << std::endl;
+			return;
+		}
+
+		const CacheHeader header{ IBL_CACHE_MAGIC, IBL_CACHE_VERSION, size, levels, faces, channels };
+		out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+		glBindTexture(target, texture);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		std::vector<float> data;
+		for (uint32_t mip = 0; mip < levels; mip++)
+		{
+			const uint32_t mipSize = size >> mip;
+			data.resize(static_cast<size_t>(mipSize) * mipSize * channels);
+			for (uint32_t face = 0; face < faces; face++)
+			{
+				const GLenum faceTarget = faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+				glGetTexImage(faceTarget, mip, channelsToFormat(channels), GL_FLOAT, data.data());
+				out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(float));
+			}
+		}
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+	}
+}
+
+ImageBasedLighting::ImageBasedLighting(const Skybox& skybox, const std::filesystem::path& cacheDir)
+{
+	allocateTextures();
+
+	std::stringstream hashStr;
+	hashStr << std::hex << hashSourceFaces(skybox.getCubeFaces());
+	const std::filesystem::path cacheEntry = cacheDir / hashStr.str();
+
+	if (loadFromCache(cacheEntry))
+	{
+		return;
+	}
+
+	//Nothing cached for this skybox, run the precompute passes
+	GLint prevViewport[4];
+	GLint prevFBO;
+	glGetIntegerv(GL_VIEWPORT, prevViewport);
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING, &prevFBO);
+	const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	const GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+
+	//Source mips are used by the prefilter pass to avoid aliasing
+	glBindTexture(GL_TEXTURE_CUBE_MAP, skybox.getTexture());
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+	unsigned int captureFBO;
+	glGenFramebuffers(1, &captureFBO);
+
+	computeIrradiance(skybox, captureFBO);
+	computePrefilter(skybox, captureFBO);
+	computeBrdfLUT(captureFBO);
+
+	glDeleteFramebuffers(1, &captureFBO);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, prevFBO);
+	glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+	if (depthTest)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	if (cullFace)
+	{
+		glEnable(GL_CULL_FACE);
+	}
+
+	saveToCache(cacheEntry);
+}
+
+ImageBasedLighting::~ImageBasedLighting()
+{
+	glDeleteTextures(1, &m_irradianceMap);
+	glDeleteTextures(1, &m_prefilterMap);
+	glDeleteTextures(1, &m_brdfLUT);
+
+	GpuMemoryTracker& tracker = GpuMemoryTracker::get();
+	tracker.release(GpuResourceKind::TEXTURE, m_irradianceMap);
+	tracker.release(GpuResourceKind::TEXTURE, m_prefilterMap);
+	tracker.release(GpuResourceKind::TEXTURE, m_brdfLUT);
+}
+
+void ImageBasedLighting::bind(const Shader& shader, int firstUnit) const
+{
+	shader.setInt("_IrradianceMap", firstUnit);
+	shader.setInt("_PrefilterMap", firstUnit + 1);
+	shader.setInt("_BrdfLUT", firstUnit + 2);
+	shader.setFloat("_PrefilterMaxLod", static_cast<float>(PREFILTER_MIP_LEVELS - 1));
+
+	glActiveTexture(GL_TEXTURE0 + firstUnit);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_irradianceMap);
+	glActiveTexture(GL_TEXTURE0 + firstUnit + 1);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_prefilterMap);
+	glActiveTexture(GL_TEXTURE0 + firstUnit + 2);
+	glBindTexture(GL_TEXTURE_2D, m_brdfLUT);
+	glActiveTexture(GL_TEXTURE0);
+	RenderStats::current().textureBinds += 3;
+}
+
+void ImageBasedLighting::allocateTextures()
+{
+	glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+	//Irradiance
+	glGenTextures(1, &m_irradianceMap);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_irradianceMap);
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, IRRADIANCE_SIZE, IRRADIANCE_SIZE, 0, GL_RGB, GL_FLOAT, nullptr);
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, m_irradianceMap,
+		GpuMemoryTracker::textureBytes(IRRADIANCE_SIZE, IRRADIANCE_SIZE, 6, 6, false), "RGB16F cube", "IBL");
+
+	//Prefiltered specular, one roughness level per mip
+	glGenTextures(1, &m_prefilterMap);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_prefilterMap);
+	uint64_t prefilterBytes = 0;
+	for (unsigned int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
+	{
+		const uint32_t mipSize = PREFILTER_SIZE >> mip;
+		prefilterBytes += GpuMemoryTracker::textureBytes(mipSize, mipSize, 6, 6, false);
+		for (unsigned int i = 0; i < 6; i++)
+		{
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, mip, GL_RGB16F, mipSize, mipSize, 0, GL_RGB, GL_FLOAT, nullptr);
+		}
+	}
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, PREFILTER_MIP_LEVELS - 1);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, m_prefilterMap, prefilterBytes, "RGB16F cube", "IBL");
+
+	//BRDF LUT
+	glGenTextures(1, &m_brdfLUT);
+	glBindTexture(GL_TEXTURE_2D, m_brdfLUT);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, BRDF_LUT_SIZE, BRDF_LUT_SIZE, 0, GL_RG, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, m_brdfLUT,
+		GpuMemoryTracker::textureBytes(BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1, 4, false), "RG16F", "IBL");
+}
+
+void ImageBasedLighting::computeIrradiance(const Skybox& skybox, uint32_t captureFBO)
+{
+	Shader irradianceShader("Shaders/CubemapCapture.vs", "Shaders/IrradianceConvolution.fs");
+	irradianceShader.use();
+	irradianceShader.setInt("_EnvironmentMap", 0);
+	irradianceShader.setMat4("projection", captureProjection);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, skybox.getTexture());
+
+	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	glViewport(0, 0, IRRADIANCE_SIZE, IRRADIANCE_SIZE);
+	for (unsigned int i = 0; i < 6; i++)
+	{
+		irradianceShader.setMat4("view", captureViews[i]);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_irradianceMap, 0);
+		skybox.DrawCube();
+	}
+}
+
+void ImageBasedLighting::computePrefilter(const Skybox& skybox, uint32_t captureFBO)
+{
+	Shader prefilterShader("Shaders/CubemapCapture.vs", "Shaders/PrefilterEnvironment.fs");
+	prefilterShader.use();
+	prefilterShader.setInt("_EnvironmentMap", 0);
+	prefilterShader.setMat4("projection", captureProjection);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, skybox.getTexture());
+	GLint sourceResolution;
+	glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &sourceResolution);
+	prefilterShader.setFloat("_SourceResolution", static_cast<float>(sourceResolution));
+
+	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	for (unsigned int mip = 0; mip < PREFILTER_MIP_LEVELS; mip++)
+	{
+		const uint32_t mipSize = PREFILTER_SIZE >> mip;
+		glViewport(0, 0, mipSize, mipSize);
+
+		const float roughness = static_cast<float>(mip) / static_cast<float>(PREFILTER_MIP_LEVELS - 1);
+		prefilterShader.setFloat("_Roughness", roughness);
+		for (unsigned int i = 0; i < 6; i++)
+		{
+			prefilterShader.setMat4("view", captureViews[i]);
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, m_prefilterMap, mip);
+			skybox.DrawCube();
+		}
+	}
+}
+
+void ImageBasedLighting::computeBrdfLUT(uint32_t captureFBO)
+{
+	float quadVertices[] =
+	{
+		//Coords		//Tex coords
+		-1.0f, 1.0f,	0.0f, 1.0f,
+		-1.0f, -1.0f,	0.0f, 0.0f,
+		1.0f, 1.0f,		1.0f, 1.0f,
+		1.0f, -1.0f,	1.0f, 0.0f
+	};
+
+	unsigned int quadVAO, quadVBO;
+	glGenVertexArrays(1, &quadVAO);
+	glGenBuffers(1, &quadVBO);
+	glBindVertexArray(quadVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+
+	Shader brdfShader("Shaders/BrdfIntegration.vs", "Shaders/BrdfIntegration.fs");
+	brdfShader.use();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, m_brdfLUT, 0);
+	glViewport(0, 0, BRDF_LUT_SIZE, BRDF_LUT_SIZE);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+
+	glBindVertexArray(0);
+	glDeleteBuffers(1, &quadVBO);
+	glDeleteVertexArrays(1, &quadVAO);
+}
+
+bool ImageBasedLighting::loadFromCache(const std::filesystem::path& dir)
+{
+	if (!std::filesystem::exists(dir))
+	{
+		return false;
+	}
+
+	return readTexture(dir / "irradiance.bin", GL_TEXTURE_CUBE_MAP, m_irradianceMap, IRRADIANCE_SIZE, 1, 6, 3) &&
+		readTexture(dir / "prefilter.bin", GL_TEXTURE_CUBE_MAP, m_prefilterMap, PREFILTER_SIZE, PREFILTER_MIP_LEVELS, 6, 3) &&
+		readTexture(dir / "brdf.bin", GL_TEXTURE_2D, m_brdfLUT, BRDF_LUT_SIZE, 1, 1, 2);
+}
+
+void ImageBasedLighting::saveToCache(const std::filesystem::path& dir) const
+{
+	std::error_code ec;
+	std::filesystem::create_directories(dir, ec);
+	if (ec)
+	{
+		std::cout << "ERROR::IBL::CACHE_DIR_FAILED " << ec.message() << std::endl;
+		return;
+	}
+
+	writeTexture(dir / "irradiance.bin", GL_TEXTURE_CUBE_MAP, m_irradianceMap, IRRADIANCE_SIZE, 1, 6, 3);
+	writeTexture(dir / "prefilter.bin", GL_TEXTURE_CUBE_MAP, m_prefilterMap, PREFILTER_SIZE, PREFILTER_MIP_LEVELS, 6, 3);
+	writeTexture(dir / "brdf.bin", GL_TEXTURE_2D, m_brdfLUT, BRDF_LUT_SIZE, 1, 1, 2);
+}
+
+uint64_t ImageBasedLighting::hashSourceFaces(const std::vector<std::string>& faces)
+{
+	//FNV-1a over face contents, so editing an image invalidates the cache
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](const char* data, size_t size)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= static_cast<unsigned char>(data[i]);
+			hash *= 1099511628211ull;
+		}
+	};
+
+	mix(reinterpret_cast<const char*>(&IBL_CACHE_VERSION), sizeof(IBL_CACHE_VERSION));
+	for (const auto& face : faces)
+	{
+		std::ifstream in(face, std::ios::binary);
+		const std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		mix(face.data(), face.size());
+		mix(bytes.data(), bytes.size());
+	}
+
+	return hash;
+}
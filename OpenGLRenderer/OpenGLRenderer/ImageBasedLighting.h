@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include "Shader.h"
+#include "Skybox.h"
+
+//Precomputed diffuse irradiance, GGX prefiltered specular and BRDF LUT built from the skybox.
+//Results are cached on disk keyed by a hash of the skybox faces, so they are computed once.
+class ImageBasedLighting
+{
+public:
+	static constexpr uint32_t IRRADIANCE_SIZE = 32;
+	static constexpr uint32_t PREFILTER_SIZE = 128;
+	static constexpr uint32_t PREFILTER_MIP_LEVELS = 5;
+	static constexpr uint32_t BRDF_LUT_SIZE = 512;
+
+	ImageBasedLighting(const Skybox& skybox, const std::filesystem::path& cacheDir);
+	ImageBasedLighting(const ImageBasedLighting& other) = delete;
+	~ImageBasedLighting();
+
+	//Binds the three maps to consecutive texture units starting at firstUnit
+	void bind(const Shader& shader, int firstUnit) const;
+
+	[[nodiscard]] uint32_t getIrradianceMap() const
+	{
+		return m_irradianceMap;
+	}
+
+	[[nodiscard]] uint32_t getPrefilterMap() const
+	{
+		return m_prefilterMap;
+	}
+
+	[[nodiscard]] uint32_t getBrdfLUT() const
+	{
+		return m_brdfLUT;
+	}
+
+private:
+	uint32_t	m_irradianceMap = 0;
+	uint32_t	m_prefilterMap = 0;
+	uint32_t	m_brdfLUT = 0;
+
+	void allocateTextures();
+
+	void computeIrradiance(const Skybox& skybox, uint32_t captureFBO);
+	void computePrefilter(const Skybox& skybox, uint32_t captureFBO);
+	void computeBrdfLUT(uint32_t captureFBO);
+
+	bool loadFromCache(const std::filesystem::path& dir);
+	void saveToCache(const std::filesystem::path& dir) const;
+
+	static uint64_t hashSourceFaces(const std::vector<std::string>& faces);
+};
@@ -2,6 +2,12 @@
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
+#include "Frustum.h"
+#include "GpuMemoryTracker.h"
+#include "GpuProfiler.h"
+#include "LocalLight.h"
+#include "RenderStats.h"
+#include "ShadowCache.h"
 #include <string>
 
 #include <gtc/type_ptr.hpp>
@@ -35,6 +41,173 @@ void ImguiLayer::drawPerfomance(float delta, int fps) noexcept
 	ImGui::End(); 
 }
 
+void ImguiLayer::drawRenderStats(const RenderStats& stats, const FrameTimeHistory& frameTimes) noexcept
+{
+	ImGui::Begin("Perfomance stats");
+	ImGui::Separator();
+	ImGui::PlotLines("Frame (ms)", frameTimes.getValues(), frameTimes.getCount(), frameTimes.getOffset(),
+		nullptr, 0.0f, frameTimes.getP99() * 1.5f, ImVec2(0.0f, 60.0f));
+	ImGui::Text("Min: %.2f  Avg: %.2f  P99: %.2f ms", frameTimes.getMin(), frameTimes.getAverage(), frameTimes.getP99());
+	ImGui::Text("Draw calls: %u", stats.drawCalls);
+	ImGui::Text("Triangles: %llu", static_cast<unsigned long long>(stats.triangles));
+	ImGui::Text("Vertices: %llu", static_cast<unsigned long long>(stats.vertices));
+	ImGui::Text("Program binds: %u", stats.programBinds);
+	ImGui::Text("Texture binds: %u", stats.textureBinds);
+	ImGui::Text("Uniform uploads: %u", stats.uniformUploads);
+	ImGui::Text("Bytes uploaded: %.1f KB", static_cast<double>(stats.bytesUploaded) / 1024.0);
+	ImGui::Text("FBO switches: %u", stats.fboSwitches);
+	ImGui::End();
+}
+
+void ImguiLayer::drawFramePipeline(bool simulationThread, float simulationMs, float renderMs, const FrameTimeHistory& latency) noexcept
+{
+	ImGui::Begin("Perfomance stats");
+	ImGui::Separator();
+	ImGui::Text("Simulation: %s", simulationThread ? "own thread" : "main thread");
+	ImGui::Text("Simulate: %.2f ms  Render CPU: %.2f ms", simulationMs, renderMs);
+	if (latency.getCount() > 0)
+	{
+		ImGui::PlotLines("Input latency (ms)", latency.getValues(), latency.getCount(), latency.getOffset(),
+			nullptr, 0.0f, latency.getP99() * 1.5f, ImVec2(0.0f, 60.0f));
+		ImGui::Text("Latency Avg: %.2f  P99: %.2f ms", latency.getAverage(), latency.getP99());
+	}
+	ImGui::End();
+}
+
+void ImguiLayer::drawCullingStats(const char* view, const CullingStats& stats) noexcept
+{
+	//Appends to the perfomance window
+	ImGui::Begin("Perfomance stats");
+	ImGui::Separator();
+	ImGui::Text("Culling (%s)", view);
+	ImGui::Text("Nodes tested: %u", stats.nodesTested);
+	ImGui::Text("Nodes culled: %u", stats.nodesCulled);
+	ImGui::Text("Visible: %u", stats.entitiesVisible);
+	ImGui::End();
+}
+
+void ImguiLayer::drawOcclusionStats(const char* method, const OcclusionStats& stats) noexcept
+{
+	ImGui::Begin("Perfomance stats");
+	ImGui::Separator();
+	ImGui::Text("Occlusion (%s)", method);
+	ImGui::Text("Tested: %u", stats.tested);
+	ImGui::Text("Culled: %u", stats.culled);
+	ImGui::Text("Drawn: %u", stats.tested - stats.culled);
+	ImGui::Text("Build: %.3f ms", stats.buildMs);
+	ImGui::End();
+}
+
+void ImguiLayer::drawClusterStats(const ClusterStats& stats) noexcept
+{
+	ImGui::Begin("Perfomance stats");
+	ImGui::Separator();
+	ImGui::Text("Clustered lights: %u", stats.lights);
+	ImGui::Text("Light indices: %u", stats.lightIndices);
+	ImGui::Text("Max per cluster: %u", stats.maxLightsPerCluster);
+	if (stats.overflow)
+	{
+		ImGui::Text("Light lists overflowed, some lights dropped");
+	}
+	ImGui::End();
+}
+
+void ImguiLayer::drawShadowStats(const ShadowCacheStats& cache, const ShadowAtlasStats& atlas, const LocalShadowStats& local) noexcept
+{
+	ImGui::Begin("Perfomance stats");
+	ImGui::Separator();
+	ImGui::Text("Shadow cascades rendered: %u", cache.rendered);
+	ImGui::Text("Shadow cascades cached: %u", cache.cached);
+	ImGui::Text("Shadowed local lights: %u", local.shadowedLights);
+	ImGui::Text("Skipped off-screen: %u", local.skippedOffscreen);
+	ImGui::Text("Skipped, no atlas space: %u", local.skippedNoSpace);
+	ImGui::Text("Local shadow views rendered: %u", local.viewsRendered);
+	ImGui::Text("Local shadow views cached: %u", local.viewsCached);
+	ImGui::Text("Atlas tiles: %u (%u reassigned, %u dropped)", atlas.tiles, atlas.reallocated, atlas.dropped);
+	ImGui::Text("Atlas texels: %.1f / %.1f M", atlas.texelsUsed / 1.0e6f, atlas.texelBudget / 1.0e6f);
+	ImGui::End();
+}
+
+void ImguiLayer::drawDepthPrePass(bool& enabled) noexcept
+{
+	ImGui::Begin("Perfomance stats");
+	ImGui::Separator();
+	ImGui::Checkbox("Depth pre-pass", &enabled);
+	ImGui::End();
+}
+
+void ImguiLayer::drawGpuTimings(const GpuProfiler& profiler) noexcept
+{
+	ImGui::Begin("GPU timings");
+	if (ImGui::BeginTable("passes", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Pass");
+		ImGui::TableSetupColumn("Last (ms)");
+		ImGui::TableSetupColumn("Average (ms)");
+		ImGui::TableHeadersRow();
+		for (const GpuPassTiming& timing : profiler.getTimings())
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(timing.name.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", timing.lastMs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", timing.averageMs);
+		}
+		ImGui::EndTable();
+	}
+	ImGui::Text("Frame: %.3f ms", profiler.getFrameMs());
+	ImGui::Text("Dropped frames: %u", profiler.getDroppedFrames());
+	ImGui::End();
+}
+
+void ImguiLayer::drawGpuMemory(const GpuMemoryTracker& tracker) noexcept
+{
+	const float MB = 1024.0f * 1024.0f;
+	const GpuMemoryTotals totals = tracker.getTotals();
+
+	ImGui::Begin("GPU memory");
+	ImGui::Text("Tracked: %.1f MB (peak %.1f MB)", tracker.getCurrentBytes() / MB, tracker.getPeakBytes() / MB);
+	ImGui::Text("Buffers: %.1f MB in %u", totals.bytes[static_cast<size_t>(GpuResourceKind::BUFFER)] / MB,
+		totals.objects[static_cast<size_t>(GpuResourceKind::BUFFER)]);
+	ImGui::Text("Textures: %.1f MB in %u", totals.bytes[static_cast<size_t>(GpuResourceKind::TEXTURE)] / MB,
+		totals.objects[static_cast<size_t>(GpuResourceKind::TEXTURE)]);
+	ImGui::Text("Renderbuffers: %.1f MB in %u", totals.bytes[static_cast<size_t>(GpuResourceKind::RENDERBUFFER)] / MB,
+		totals.objects[static_cast<size_t>(GpuResourceKind::RENDERBUFFER)]);
+
+	const GpuDriverMemory& driver = tracker.getDriverMemory();
+	if (driver.source == nullptr)
+	{
+		ImGui::TextUnformatted("Driver budget: unavailable");
+	}
+	else if (driver.totalKB >= 0)
+	{
+		ImGui::Text("Driver budget: %.1f / %.1f MB free (%s)", driver.availableKB / 1024.0f, driver.totalKB / 1024.0f, driver.source);
+	}
+	else
+	{
+		ImGui::Text("Driver budget: %.1f MB free (%s)", driver.availableKB / 1024.0f, driver.source);
+	}
+
+	if (ImGui::BeginTable("owners", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+	{
+		ImGui::TableSetupColumn("Owner");
+		ImGui::TableSetupColumn("MB");
+		ImGui::TableHeadersRow();
+		for (const auto& tag : totals.byTag)
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextUnformatted(tag.first.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.2f", tag.second / MB);
+		}
+		ImGui::EndTable();
+	}
+	ImGui::End();
+}
+
 void ImguiLayer::drawDirLightProperties(glm::vec3& ambient, glm::vec3& diffuse, glm::vec3& specular, glm::vec3& pos)
 {
 	ImGui::Begin("Directional light");
@@ -3,6 +3,17 @@
 #include <GLFW/glfw3.h>
 #include <glm.hpp>
 
+struct CullingStats;
+struct OcclusionStats;
+struct ClusterStats;
+struct ShadowCacheStats;
+struct ShadowAtlasStats;
+struct LocalShadowStats;
+class GpuProfiler;
+class GpuMemoryTracker;
+struct RenderStats;
+class FrameTimeHistory;
+
 class ImguiLayer
 {
 public:
@@ -12,6 +23,15 @@ public:
 	void init(GLFWwindow* wnd) noexcept;
 	void newFrame() noexcept;
 	void drawPerfomance(float delta, int fps) noexcept;
+	void drawRenderStats(const RenderStats& stats, const FrameTimeHistory& frameTimes) noexcept;
+	void drawFramePipeline(bool simulationThread, float simulationMs, float renderMs, const FrameTimeHistory& latency) noexcept;
+	void drawCullingStats(const char* view, const CullingStats& stats) noexcept;
+	void drawOcclusionStats(const char* method, const OcclusionStats& stats) noexcept;
+	void drawClusterStats(const ClusterStats& stats) noexcept;
+	void drawShadowStats(const ShadowCacheStats& cache, const ShadowAtlasStats& atlas, const LocalShadowStats& local) noexcept;
+	void drawDepthPrePass(bool& enabled) noexcept;
+	void drawGpuTimings(const GpuProfiler& profiler) noexcept;
+	void drawGpuMemory(const GpuMemoryTracker& tracker) noexcept;
 	void drawDirLightProperties(glm::vec3& ambient, glm::vec3& diffuse,
 								glm::vec3& specular, glm::vec3& pos);
 	void render() const noexcept;
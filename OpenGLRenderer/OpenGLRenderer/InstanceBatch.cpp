@@ -0,0 +1,66 @@
+#include "InstanceBatch.h"
+
+#include "GpuMemoryTracker.h"
+#include "RenderStats.h"
+
+InstanceBatch::InstanceBatch(Model& model) : m_model(model)
+{
+	glGenBuffers(1, &m_instanceVBO);
+	m_model.setupInstanceAttributes(m_instanceVBO);
+}
+
+InstanceBatch::~InstanceBatch()
+{
+	glDeleteBuffers(1, &m_instanceVBO);
+	GpuMemoryTracker::get().release(GpuResourceKind::BUFFER, m_instanceVBO);
+}
+
+void InstanceBatch::add(const glm::mat4& modelMatrix)
+{
+	m_instances.push_back(modelMatrix);
+	m_bounds.expand(m_model.getBounds().transformed(modelMatrix));
+	m_dirty = true;
+}
+
+void InstanceBatch::clear()
+{
+	m_instances.clear();
+	m_bounds = AABB();
+	m_dirty = true;
+}
+
+void InstanceBatch::upload()
+{
+	if (!m_dirty)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+	const size_t size = m_instances.size() * sizeof(glm::mat4);
+	if (m_instances.size() > m_capacity)
+	{
+		m_capacity = m_instances.size();
+		glBufferData(GL_ARRAY_BUFFER, size, m_instances.data(), GL_DYNAMIC_DRAW);
+		GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, m_instanceVBO, size, "mat4", "InstanceBatch");
+	}
+	else if (size > 0)
+	{
+		glBufferSubData(GL_ARRAY_BUFFER, 0, size, m_instances.data());
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	RenderStats::current().bytesUploaded += size;
+
+	m_dirty = false;
+}
+
+void InstanceBatch::Draw(Shader& shader)
+{
+	if (m_instances.empty())
+	{
+		return;
+	}
+
+	upload();
+	m_model.DrawInstanced(shader, getInstanceCount());
+}
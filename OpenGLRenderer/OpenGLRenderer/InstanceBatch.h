@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#include "Bounds.h"
+#include "Model.h"
+
+//Draws many copies of the same model with a single instanced draw per mesh.
+//Per-instance model matrices live in a vertex buffer read through attribute divisors.
+class InstanceBatch
+{
+public:
+	explicit InstanceBatch(Model& model);
+	InstanceBatch(const InstanceBatch& other) = delete;
+	~InstanceBatch();
+
+	void add(const glm::mat4& modelMatrix);
+	void clear();
+	//Uploads instances added since the last upload
+	void upload();
+
+	void Draw(Shader& shader);
+
+	[[nodiscard]] unsigned int getInstanceCount() const
+	{
+		return static_cast<unsigned int>(m_instances.size());
+	}
+
+	//World space bounds of every instance
+	[[nodiscard]] const AABB& getBounds() const
+	{
+		return m_bounds;
+	}
+
+private:
+	Model&					m_model;
+	std::vector<glm::mat4>	m_instances;
+	AABB					m_bounds;
+
+	unsigned int			m_instanceVBO = 0;
+	size_t					m_capacity = 0;
+	bool					m_dirty = false;
+};
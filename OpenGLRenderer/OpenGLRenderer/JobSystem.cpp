@@ -0,0 +1,220 @@
+#include "JobSystem.h"
+
+thread_local size_t JobSystem::s_queue = 0;
+
+JobSystem& JobSystem::get()
+{
+	static JobSystem jobSystem;
+	return jobSystem;
+}
+
+JobSystem::~JobSystem()
+{
+	stop();
+}
+
+void JobSystem::start(int workerCount)
+{
+	if (m_running)
+	{
+		return;
+	}
+
+	if (workerCount < 0)
+	{
+		const unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? static_cast<int>(hardwareThreads) - 1 : 0;
+	}
+
+	m_queues.clear();
+	for (int i = 0; i <= workerCount; i++)
+	{
+		m_queues.push_back(std::make_unique<WorkQueue>());
+	}
+
+	m_running = true;
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.emplace_back(&JobSystem::workerLoop, this, static_cast<size_t>(i + 1));
+	}
+}
+
+void JobSystem::stop()
+{
+	if (!m_running)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_running = false;
+	}
+	m_wake.notify_all();
+	for (std::thread& worker : m_workers)
+	{
+		worker.join();
+	}
+	m_workers.clear();
+
+	//Without workers nothing else drains the shared queue
+	while (runOne())
+	{
+	}
+	m_queues.clear();
+}
+
+void JobSystem::run(const char* name, std::function<void()> function, JobCounter* counter, JobCounter* dependency)
+{
+	Job job;
+	job.name = name;
+	job.function = std::move(function);
+	job.counter = counter;
+	if (counter)
+	{
+		counter->m_pending.fetch_add(1, std::memory_order_acq_rel);
+	}
+
+	if (dependency)
+	{
+		std::lock_guard<std::mutex> lock(dependency->m_mutex);
+		if (dependency->m_pending.load(std::memory_order_acquire) > 0)
+		{
+			dependency->m_continuations.push_back(std::move(job));
+			return;
+		}
+	}
+	push(std::move(job));
+}
+
+void JobSystem::wait(JobCounter& counter)
+{
+	PROFILE_SCOPE("JobSystem::wait");
+	while (!counter.isDone())
+	{
+		if (!runOne())
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	//The job that finished the counter may still hold its mutex
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+void JobSystem::push(Job job)
+{
+	if (!m_running)
+	{
+		execute(job);
+		return;
+	}
+
+	{
+		WorkQueue& queue = *m_queues[s_queue];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.jobs.push_back(std::move(job));
+	}
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_queued.fetch_add(1, std::memory_order_release);
+	}
+	m_wake.notify_one();
+}
+
+bool JobSystem::runOne()
+{
+	if (m_queues.empty())
+	{
+		return false;
+	}
+
+	Job job;
+	bool found = false;
+	{
+		//Newest job of the own queue, its data is most likely still in cache
+		WorkQueue& own = *m_queues[s_queue];
+		std::lock_guard<std::mutex> lock(own.mutex);
+		if (!own.jobs.empty())
+		{
+			job = std::move(own.jobs.back());
+			own.jobs.pop_back();
+			found = true;
+		}
+	}
+
+	//Oldest job of another queue, usually the largest remaining piece of work
+	for (size_t i = 1; i < m_queues.size() && !found; i++)
+	{
+		WorkQueue& victim = *m_queues[(s_queue + i) % m_queues.size()];
+		std::lock_guard<std::mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = std::move(victim.jobs.front());
+			victim.jobs.pop_front();
+			found = true;
+		}
+	}
+
+	if (!found)
+	{
+		return false;
+	}
+
+	m_queued.fetch_sub(1, std::memory_order_acq_rel);
+	execute(job);
+	return true;
+}
+
+void JobSystem::execute(Job& job)
+{
+	{
+		CpuProfileScope scope(job.name);
+		job.function();
+	}
+	finish(job.counter);
+}
+
+void JobSystem::finish(JobCounter* counter)
+{
+	if (counter == nullptr)
+	{
+		return;
+	}
+
+	std::vector<Job> ready;
+	{
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		if (counter->m_pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			ready.swap(counter->m_continuations);
+		}
+	}
+
+	for (Job& job : ready)
+	{
+		push(std::move(job));
+	}
+}
+
+void JobSystem::workerLoop(size_t queue)
+{
+	s_queue = queue;
+	while (true)
+	{
+		if (runOne())
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wake.wait(lock, [this]()
+		{
+			return m_queued.load(std::memory_order_acquire) > 0 || !m_running;
+		});
+		if (!m_running && m_queued.load(std::memory_order_acquire) == 0)
+		{
+			return;
+		}
+	}
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CpuProfiler.h"
+
+class JobCounter;
+
+struct Job
+{
+	//Profiler marker of the job, must be a string literal
+	const char*				name = nullptr;
+	std::function<void()>	function;
+	JobCounter*				counter = nullptr;
+};
+
+//Number of unfinished jobs in a group. Other jobs can be scheduled to start once it reaches zero.
+//Only destroy a counter after JobSystem::wait returned for it.
+class JobCounter
+{
+public:
+	JobCounter() = default;
+	JobCounter(const JobCounter& other) = delete;
+
+	[[nodiscard]] bool isDone() const
+	{
+		return m_pending.load(std::memory_order_acquire) == 0;
+	}
+
+private:
+	friend class JobSystem;
+
+	std::atomic<int>	m_pending{ 0 };
+	//Guards the transition to zero against jobs being attached as continuations
+	std::mutex			m_mutex;
+	std::vector<Job>	m_continuations;
+};
+
+//Work-stealing job system. Every worker owns a deque it pushes to and pops from at the back, idle
+//workers steal from the front of the others. Threads that are not workers share one extra deque.
+//A thread waiting for a counter runs jobs in the meantime, so nested parallelFor calls never block
+//a worker and zero workers still completes every job on the waiting thread.
+class JobSystem
+{
+public:
+	static JobSystem& get();
+
+	JobSystem(const JobSystem& other) = delete;
+	~JobSystem();
+
+	//workerCount -1 picks one less than the hardware concurrency. Until started every job runs inline
+	void start(int workerCount = -1);
+	//Finishes the queued jobs and joins the workers
+	void stop();
+
+	[[nodiscard]] unsigned int getWorkerCount() const
+	{
+		return static_cast<unsigned int>(m_workers.size());
+	}
+
+	//function starts once dependency reaches zero, counter is incremented until it finished
+	void run(const char* name, std::function<void()> function, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+	//Runs queued jobs until counter reaches zero
+	void wait(JobCounter& counter);
+
+	//Calls function(begin, end) for ranges of at most grain items covering [0, count). The calling
+	//thread takes the first range and helps with the rest, returns once all of them ran
+	template<typename TFunction>
+	void parallelFor(const char* name, size_t count, size_t grain, TFunction&& function)
+	{
+		grain = std::max<size_t>(grain, 1);
+		if (count <= grain || m_workers.empty())
+		{
+			if (count > 0)
+			{
+				CpuProfileScope scope(name);
+				function(size_t(0), count);
+			}
+			return;
+		}
+
+		JobCounter counter;
+		for (size_t begin = grain; begin < count; begin += grain)
+		{
+			const size_t end = std::min(count, begin + grain);
+			run(name, [&function, begin, end]()
+			{
+				function(begin, end);
+			}, &counter);
+		}
+
+		{
+			CpuProfileScope scope(name);
+			function(size_t(0), grain);
+		}
+		wait(counter);
+	}
+
+private:
+	struct WorkQueue
+	{
+		std::mutex			mutex;
+		std::deque<Job>		jobs;
+	};
+
+	//Queue 0 belongs to threads that are not workers, worker i owns queue i + 1
+	std::vector<std::unique_ptr<WorkQueue>>	m_queues;
+	std::vector<std::thread>				m_workers;
+	std::atomic<bool>						m_running{ false };
+	std::atomic<int>						m_queued{ 0 };
+	std::mutex								m_sleepMutex;
+	std::condition_variable					m_wake;
+
+	static thread_local size_t s_queue;
+
+	JobSystem() = default;
+
+	void push(Job job);
+	//Pops from the own queue or steals from another, runs the job if one was found
+	bool runOne();
+	void execute(Job& job);
+	void finish(JobCounter* counter);
+	void workerLoop(size_t queue);
+};
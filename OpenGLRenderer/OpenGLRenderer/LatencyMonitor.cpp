@@ -0,0 +1,60 @@
+#include "LatencyMonitor.h"
+
+#include <algorithm>
+
+#include <glad/glad.h>
+
+LatencyMonitor::LatencyMonitor()
+{
+	for (FrameSlot& slot : m_slots)
+	{
+		glGenQueries(1, &slot.query);
+	}
+}
+
+LatencyMonitor::~LatencyMonitor()
+{
+	for (FrameSlot& slot : m_slots)
+	{
+		glDeleteQueries(1, &slot.query);
+	}
+}
+
+void LatencyMonitor::endFrame(uint64_t frame, std::chrono::steady_clock::time_point inputTime)
+{
+	FrameSlot& slot = m_slots[m_slot];
+	resolve(slot);
+
+	glQueryCounter(slot.query, GL_TIMESTAMP);
+	//Current GPU time paired with the CPU clock, both sides of the mapping for this frame's query
+	GLint64 gpuNow = 0;
+	glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+	slot.cpuSubmit = std::chrono::steady_clock::now();
+	slot.gpuSubmit = gpuNow;
+	slot.inputTime = inputTime;
+	slot.frame = static_cast<int64_t>(frame);
+
+	m_slot = (m_slot + 1) % FRAME_LATENCY;
+}
+
+void LatencyMonitor::resolve(FrameSlot& slot)
+{
+	if (slot.frame < 0)
+	{
+		return;
+	}
+
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available)
+	{
+		GLuint64 gpuDone = 0;
+		glGetQueryObjectui64v(slot.query, GL_QUERY_RESULT, &gpuDone);
+		const int64_t gpuAfterSubmit = std::max<int64_t>(0, static_cast<int64_t>(gpuDone) - slot.gpuSubmit);
+		const auto presented = slot.cpuSubmit + std::chrono::nanoseconds(gpuAfterSubmit);
+		m_latencyMs = std::chrono::duration<float, std::milli>(presented - slot.inputTime).count();
+		m_resolvedFrame = slot.frame;
+		m_history.push(m_latencyMs);
+	}
+	slot.frame = -1;
+}
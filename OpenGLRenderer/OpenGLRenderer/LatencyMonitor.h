@@ -0,0 +1,57 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+#include "RenderStats.h"
+
+//Input-to-present latency per frame: from the poll that produced the frame's input until the GPU
+//finished the frame's last command. A GL_TIMESTAMP query marks the end of each frame and is mapped to
+//the CPU clock with a GPU timestamp taken at submission. Queries live in a ring like GpuProfiler's and
+//resolve FRAME_LATENCY - 1 frames late. Compositor and scanout delay are not included.
+class LatencyMonitor
+{
+public:
+	static constexpr int FRAME_LATENCY = 4;
+
+	LatencyMonitor();
+	LatencyMonitor(const LatencyMonitor& other) = delete;
+	~LatencyMonitor();
+
+	//Call after the frame's last command, before swapping buffers
+	void endFrame(uint64_t frame, std::chrono::steady_clock::time_point inputTime);
+
+	//Frame the last result belongs to, -1 before any
+	[[nodiscard]] int64_t getResolvedFrame() const
+	{
+		return m_resolvedFrame;
+	}
+
+	[[nodiscard]] float getLatencyMs() const
+	{
+		return m_latencyMs;
+	}
+
+	[[nodiscard]] const FrameTimeHistory& getHistory() const
+	{
+		return m_history;
+	}
+
+private:
+	struct FrameSlot
+	{
+		unsigned int	query = 0;
+		int64_t			frame = -1;
+		std::chrono::steady_clock::time_point	inputTime;
+		std::chrono::steady_clock::time_point	cpuSubmit;
+		int64_t			gpuSubmit = 0;
+	};
+
+	FrameSlot			m_slots[FRAME_LATENCY];
+	int					m_slot = 0;
+	int64_t				m_resolvedFrame = -1;
+	float				m_latencyMs = 0.0f;
+	FrameTimeHistory	m_history;
+
+	void resolve(FrameSlot& slot);
+};
@@ -5,22 +5,30 @@ void Light::updateMatrices(glm::vec3 center = glm::vec3(0.0f, 0.0f, 0.0f), glm::
 	//For some reason I need use reversed world up vector
 	m_view = glm::lookAt(m_pos, center, up);
 	m_worldToClip = m_projection * m_view;
+	m_direction = glm::normalize(center - m_pos);
+	m_version++;
 }
 
 Light::Light(const Light& l)
 {
 	m_pos = l.m_pos;
+	m_direction = l.m_direction;
 	m_projection = l.m_projection;
 	m_view = l.m_view;
 	m_worldToClip = l.m_worldToClip;
+	m_cascades = l.m_cascades;
+	m_version = l.m_version;
 }
 
 Light::Light(Light&& l) noexcept
 {
 	m_pos = std::move(l.m_pos);
+	m_direction = std::move(l.m_direction);
 	m_projection = std::move(l.m_projection);
 	m_view = std::move(l.m_view);
 	m_worldToClip = std::move(l.m_worldToClip);
+	m_cascades = std::move(l.m_cascades);
+	m_version = l.m_version;
 }
 
 Light::Light(float left, float right, float bottom, float top, float near, float far, glm::vec3 pos)
@@ -70,3 +78,81 @@ glm::mat4 Light::getWorldToClip() const noexcept
 {
 	return m_worldToClip; 
 }
+
+void Light::updateCascades(const glm::mat4& cameraView, float fovY, float aspect, float near, float far,
+						   int cascadeCount, float lambda, const int* resolutions, const AABB& sceneBounds)
+{
+	cascadeCount = glm::clamp(cascadeCount, 1, MAX_CASCADES);
+	m_cascades.resize(cascadeCount);
+
+	//Rotation only light view, cascades are positioned in its space
+	const glm::vec3 up = glm::abs(m_direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	const glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), m_direction, up);
+	const glm::mat4 cameraToWorld = glm::inverse(cameraView);
+
+	//Nearest scene depth towards the light
+	float sceneMaxZ = -FLT_MAX;
+	if (sceneBounds.isValid())
+	{
+		for (int i = 0; i < 8; i++)
+		{
+			const glm::vec3 corner((i & 1) ? sceneBounds.max.x : sceneBounds.min.x,
+								   (i & 2) ? sceneBounds.max.y : sceneBounds.min.y,
+								   (i & 4) ? sceneBounds.max.z : sceneBounds.min.z);
+			sceneMaxZ = glm::max(sceneMaxZ, (lightView * glm::vec4(corner, 1.0f)).z);
+		}
+	}
+
+	const float tanHalfY = glm::tan(fovY * 0.5f);
+	const float tanHalfX = tanHalfY * aspect;
+
+	float splitNear = near;
+	for (int cascade = 0; cascade < cascadeCount; cascade++)
+	{
+		//Practical split scheme
+		const float t = static_cast<float>(cascade + 1) / cascadeCount;
+		const float logSplit = near * glm::pow(far / near, t);
+		const float uniformSplit = near + (far - near) * t;
+		const float splitFar = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+
+		//Slice corners in world space
+		glm::vec3 corners[8];
+		for (int i = 0; i < 8; i++)
+		{
+			const float depth = (i & 4) ? splitFar : splitNear;
+			const glm::vec3 viewCorner(((i & 1) ? 1.0f : -1.0f) * tanHalfX * depth, ((i & 2) ? 1.0f : -1.0f) * tanHalfY * depth, -depth);
+			corners[i] = glm::vec3(cameraToWorld * glm::vec4(viewCorner, 1.0f));
+		}
+
+		glm::vec3 center(0.0f);
+		for (const glm::vec3& corner : corners)
+		{
+			center += corner;
+		}
+		center /= 8.0f;
+
+		float radius = 0.0f;
+		for (const glm::vec3& corner : corners)
+		{
+			radius = glm::max(radius, glm::length(corner - center));
+		}
+		//Rounded up so the size only changes with the projection
+		radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+		//Snap the center to whole texels in light space
+		const float texelSize = 2.0f * radius / resolutions[cascade];
+		glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+		lightCenter.x = glm::floor(lightCenter.x / texelSize) * texelSize;
+		lightCenter.y = glm::floor(lightCenter.y / texelSize) * texelSize;
+
+		//Light looks down -z, near covers casters between the light and the slice
+		const float maxZ = glm::max(lightCenter.z + radius, sceneMaxZ);
+		const float minZ = lightCenter.z - radius;
+		const glm::mat4 projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius,
+			lightCenter.y - radius, lightCenter.y + radius, -maxZ, -minZ);
+
+		m_cascades[cascade].worldToClip = projection * lightView;
+		m_cascades[cascade].splitDepth = splitFar;
+		splitNear = splitFar;
+	}
+}
@@ -1,17 +1,38 @@
 #pragma once
 
+#include <cstdint>
+#include <vector>
+
 #include <glm.hpp>
 #include <gtc/matrix_transform.hpp>
 #include <gtc/type_ptr.hpp>
 
+#include "Bounds.h"
+
+struct ShadowCascade
+{
+	glm::mat4 worldToClip;
+	//View space distance where the cascade ends
+	float splitDepth;
+};
+
 class Light
 {
+public:
+	static constexpr int MAX_CASCADES = 4;
+
 private:
 	glm::mat4 m_projection;
 	glm::mat4 m_view;
 	glm::mat4 m_worldToClip;
 
 	glm::vec3 m_pos;
+	glm::vec3 m_direction;
+
+	std::vector<ShadowCascade> m_cascades;
+
+	//Incremented whenever the view or projection changes, shadow caches compare against it
+	uint32_t m_version = 0;
 
 	void updateMatrices(glm::vec3, glm::vec3) noexcept;
 
@@ -31,4 +52,28 @@ public:
 	void setView(const glm::vec3& center, const glm::vec3& up) noexcept;
 
 	glm::mat4 getWorldToClip() const noexcept;
+
+	glm::vec3 getPosition() const noexcept
+	{
+		return m_pos;
+	}
+
+	uint32_t getVersion() const noexcept
+	{
+		return m_version;
+	}
+
+	//Fits cascadeCount orthographic shadow views to slices of the camera frustum. Splits blend
+	//logarithmic and uniform distributions by lambda (practical split scheme). Each cascade bounds
+	//its slice with a sphere so the projection size never changes, and is snapped to whole
+	//shadow map texels so shadows do not shimmer when the camera moves.
+	//Depth ranges are extended to sceneBounds so casters outside a slice still cast into it.
+	//resolutions holds the shadow map size of each cascade.
+	void updateCascades(const glm::mat4& cameraView, float fovY, float aspect, float near, float far,
+						int cascadeCount, float lambda, const int* resolutions, const AABB& sceneBounds);
+
+	const std::vector<ShadowCascade>& getCascades() const noexcept
+	{
+		return m_cascades;
+	}
 };
\ No newline at end of file
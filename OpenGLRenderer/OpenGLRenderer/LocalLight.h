@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm.hpp>
+
+enum class LightType : uint32_t
+{
+	POINT = 0,
+	SPOT = 1
+};
+
+struct LocalLight
+{
+	LightType type = LightType::POINT;
+	glm::vec3 position = glm::vec3(0.0f);
+	//Spot lights only, cut offs are cosines of the inner and outer cone angles
+	glm::vec3 direction = glm::vec3(0.0f, -1.0f, 0.0f);
+	float cutOff = 0.0f;
+	float outerCutOff = 0.0f;
+
+	glm::vec3 diffuse = glm::vec3(1.0f);
+	glm::vec3 specular = glm::vec3(1.0f);
+	float intensity = 1.0f;
+
+	float constant = 1.0f;
+	float linear = 0.09f;
+	float quadratic = 0.032f;
+	//Influence radius, 0 derives it from the attenuation
+	float range = 0.0f;
+
+	//shadowIndex is the first shadow atlas tile, assigned by LocalLightShadows each frame, -1 when unshadowed
+	bool castsShadows = false;
+	int shadowIndex = -1;
+};
+
+struct ClusterStats
+{
+	uint32_t lights = 0;
+	uint32_t lightIndices = 0;
+	uint32_t maxLightsPerCluster = 0;
+	bool overflow = false;
+};
+
+struct LocalShadowStats
+{
+	uint32_t shadowedLights = 0;
+	uint32_t skippedOffscreen = 0;
+	uint32_t skippedNoSpace = 0;
+	uint32_t viewsRendered = 0;
+	uint32_t viewsCached = 0;
+};
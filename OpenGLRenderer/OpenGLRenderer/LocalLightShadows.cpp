@@ -0,0 +1,143 @@
+#include "LocalLightShadows.h"
+
+#include <cmath>
+
+#include "ClusteredLighting.h"
+#include "ShadowCache.h"
+
+namespace
+{
+	//Cube face forward and up vectors, matches CUBE_FORWARD and CUBE_UP in the lighting shaders
+	const glm::vec3 FACE_FORWARD[6] = {
+		glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+		glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+	};
+	const glm::vec3 FACE_UP[6] = {
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+		glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f),
+		glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)
+	};
+}
+
+void LocalLightShadows::request(const std::vector<LocalLight>& lights, ShadowAtlas& atlas, const Frustum& cameraFrustum,
+								const glm::vec3& cameraPos, float screenScale)
+{
+	m_requested.clear();
+	m_stats = LocalShadowStats();
+
+	int tileCount = 0;
+	for (size_t i = 0; i < lights.size(); i++)
+	{
+		const LocalLight& light = lights[i];
+		if (!light.castsShadows)
+		{
+			continue;
+		}
+
+		const float range = ClusteredLighting::computeRange(light);
+		AABB bounds;
+		bounds.min = light.position - glm::vec3(range);
+		bounds.max = light.position + glm::vec3(range);
+		if (!cameraFrustum.isVisible(bounds))
+		{
+			m_stats.skippedOffscreen++;
+			continue;
+		}
+
+		const int count = light.type == LightType::POINT ? 6 : 1;
+		if (tileCount + count > MAX_SHADOW_TILES)
+		{
+			m_stats.skippedNoSpace++;
+			continue;
+		}
+		tileCount += count;
+
+		//Projected diameter in pixels, cameras inside the sphere get the largest tiles.
+		//A cube face covers roughly half of it
+		const float distance = glm::length(light.position - cameraPos);
+		const float importance = distance > range
+			? 2.0f * range * screenScale / std::sqrt(distance * distance - range * range)
+			: static_cast<float>(ShadowAtlas::SIZE);
+		const float desired = light.type == LightType::POINT ? importance * 0.5f : importance;
+		const int size = static_cast<int>(glm::min(desired, static_cast<float>(MAX_TILE_SIZE)));
+
+		atlas.request(ShadowAtlas::makeKey(ShadowOwner::LOCAL_LIGHT, static_cast<uint32_t>(i)), count, size, importance);
+		m_requested.push_back(i);
+	}
+}
+
+void LocalLightShadows::update(std::vector<LocalLight>& lights, const ShadowAtlas& atlas)
+{
+	m_views.clear();
+	for (LocalLight& light : lights)
+	{
+		light.shadowIndex = -1;
+	}
+
+	for (size_t index : m_requested)
+	{
+		const std::vector<glm::ivec4>* tiles = atlas.getTiles(ShadowAtlas::makeKey(ShadowOwner::LOCAL_LIGHT, static_cast<uint32_t>(index)));
+		if (!tiles)
+		{
+			m_stats.skippedNoSpace++;
+			continue;
+		}
+
+		const bool reallocated = atlas.wasReallocated(ShadowAtlas::makeKey(ShadowOwner::LOCAL_LIGHT, static_cast<uint32_t>(index)));
+		LocalLight& light = lights[index];
+		light.shadowIndex = static_cast<int>(m_views.size());
+		const float range = ClusteredLighting::computeRange(light);
+
+		if (light.type == LightType::POINT)
+		{
+			const glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, NEAR_PLANE, range);
+			for (int face = 0; face < 6; face++)
+			{
+				const glm::mat4 view = glm::lookAt(light.position, light.position + FACE_FORWARD[face], FACE_UP[face]);
+				m_views.push_back({ projection * view, (*tiles)[face], (static_cast<uint64_t>(index) << 3) | face, reallocated });
+			}
+		}
+		else
+		{
+			//Same basis as SpotShadow in the lighting shaders
+			const glm::vec3 direction = glm::normalize(light.direction);
+			const glm::vec3 up = glm::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			const glm::mat4 projection = glm::perspective(2.0f * glm::acos(light.outerCutOff), 1.0f, NEAR_PLANE, range);
+			const glm::mat4 view = glm::lookAt(light.position, light.position + direction, up);
+			m_views.push_back({ projection * view, (*tiles)[0], static_cast<uint64_t>(index) << 3, reallocated });
+		}
+		m_stats.shadowedLights++;
+	}
+}
+
+bool LocalLightShadows::needsRender(size_t view, const std::vector<Entity*>& casters)
+{
+	const LocalShadowView& shadowView = m_views[view];
+	const uint64_t signature = ShadowCache::casterSignature(casters);
+
+	auto it = m_viewStates.find(shadowView.cacheKey);
+	const bool dirty = it == m_viewStates.end() || shadowView.reallocated ||
+		it->second.worldToClip != shadowView.worldToClip || it->second.casterSignature != signature;
+	m_viewStates[shadowView.cacheKey] = { shadowView.worldToClip, signature };
+
+	if (dirty)
+	{
+		m_stats.viewsRendered++;
+	}
+	else
+	{
+		m_stats.viewsCached++;
+	}
+	return dirty;
+}
+
+void LocalLightShadows::bind(const Shader& shader) const
+{
+	for (size_t i = 0; i < m_views.size(); i++)
+	{
+		const glm::vec4 tile = glm::vec4(m_views[i].viewport) / static_cast<float>(ShadowAtlas::SIZE);
+		shader.setVec4("_ShadowTiles[" + std::to_string(i) + "]", tile);
+	}
+	shader.setFloat("_LocalShadowNear", NEAR_PLANE);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "Frustum.h"
+#include "LocalLight.h"
+#include "ShadowAtlas.h"
+
+class Entity;
+
+struct LocalShadowView
+{
+	glm::mat4 worldToClip;
+	//Atlas pixels: x, y, size, size
+	glm::ivec4 viewport;
+	//Light index and cube face, identifies the view across frames
+	uint64_t cacheKey;
+	//The tile was assigned this frame, its previous contents belong to another view
+	bool reallocated;
+};
+
+//Shadows for point and spot lights rendered into ShadowAtlas tiles. Point lights request six tiles,
+//one per cube face, spot lights one. Tile sizes follow the light's projected size on screen and
+//lights whose influence sphere is outside the camera frustum are skipped. Views are rendered one by
+//one so each culls its own casters; the shader picks the cube face from the major axis. Like
+//ShadowCache, a view keeps its tile contents until its matrix, tile or casters change.
+class LocalLightShadows
+{
+public:
+	static constexpr int MAX_TILE_SIZE = 1024;
+	//Matches MAX_SHADOW_TILES in the lighting shaders
+	static constexpr int MAX_SHADOW_TILES = 64;
+	static constexpr float NEAR_PLANE = 0.05f;
+
+	//Requests atlas tiles for the shadowed, on-screen lights.
+	//screenScale converts view space size over distance to pixels, height / (2 * tan(fovY / 2))
+	void request(const std::vector<LocalLight>& lights, ShadowAtlas& atlas, const Frustum& cameraFrustum,
+				 const glm::vec3& cameraPos, float screenScale);
+
+	//Reads the atlas assignment back, writes each light's shadowIndex and builds the views to render
+	void update(std::vector<LocalLight>& lights, const ShadowAtlas& atlas);
+
+	//True when the view's tile has to be re-rendered for these casters
+	bool needsRender(size_t view, const std::vector<Entity*>& casters);
+
+	void bind(const Shader& shader) const;
+
+	const std::vector<LocalShadowView>& getViews() const
+	{
+		return m_views;
+	}
+
+	[[nodiscard]] const LocalShadowStats& getStats() const
+	{
+		return m_stats;
+	}
+
+private:
+	struct ViewState
+	{
+		//Covers every light property the view depends on: position, direction, cone and range
+		glm::mat4	worldToClip;
+		uint64_t	casterSignature = 0;
+	};
+
+	std::vector<LocalShadowView>	m_views;
+	std::unordered_map<uint64_t, ViewState>	m_viewStates;
+	//Light indices requested this frame
+	std::vector<size_t>				m_requested;
+
+	LocalShadowStats				m_stats;
+};
@@ -1,22 +1,73 @@
 #include "Mesh.h"
 
+#include "GpuMemoryTracker.h"
+#include "RenderStats.h"
+
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures)
 {
 	this->vertices = vertices;
 	this->indices = indices;
 	this->textures = textures;
 
+	for (const auto& vertex : vertices)
+	{
+		bounds.expand(vertex.position);
+	}
+
 	setupMesh();
 }
 
-void Mesh::ClearData()
+void Mesh::Draw(Shader& shader)
+{
+	bindTextures(shader);
+
+	glBindVertexArray(VAO.get());
+	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	RenderStats::current().addDraw(indices.size());
+	//Setting up default value
+	glBindVertexArray(0);
+}
+
+void Mesh::DrawInstanced(Shader& shader, unsigned int instanceCount)
 {
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
+	bindTextures(shader);
+
+	glBindVertexArray(VAO.get());
+	glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instanceCount);
+	RenderStats::current().addDraw(indices.size(), instanceCount);
+	//Setting up default value
+	glBindVertexArray(0);
 }
 
-void Mesh::Draw(Shader& shader)
+void Mesh::DrawIndirect(Shader& shader, size_t commandOffset)
+{
+	bindTextures(shader);
+
+	glBindVertexArray(VAO.get());
+	glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)commandOffset);
+	//Instance count is written by the GPU, only the call is known here
+	RenderStats::current().drawCalls++;
+	//Setting up default value
+	glBindVertexArray(0);
+}
+
+void Mesh::setupInstanceAttributes(unsigned int instanceVBO)
+{
+	glBindVertexArray(VAO.get());
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+
+	//mat4 takes four consecutive vec4 attribute slots
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		glEnableVertexAttribArray(3 + i);
+		glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::vec4)));
+		glVertexAttribDivisor(3 + i, 1);
+	}
+
+	glBindVertexArray(0);
+}
+
+void Mesh::bindTextures(Shader& shader)
 {
 	unsigned int diffuseNr = 1;
 	unsigned int specularNr = 1;
@@ -36,32 +87,31 @@ void Mesh::Draw(Shader& shader)
 			number = std::to_string(specularNr++);
 		}
 
-		shader.setInt("material." + type + number, i);
+		shader.setInt("_Material." + type + number, i);
 		glBindTexture(GL_TEXTURE_2D, textures[i].id);
+		RenderStats::current().textureBinds++;
 	}
 	//Setting up default value
 	glActiveTexture(GL_TEXTURE0);
-
-	glBindVertexArray(VAO);
-	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-	//Setting up default value
-	glBindVertexArray(0);
 }
 
 void Mesh::setupMesh()
 {
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
+	VAO = GLVertexArray::create();
+	VBO = GLBuffer::create();
+	EBO = GLBuffer::create();
 
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBindVertexArray(VAO.get());
+	glBindBuffer(GL_ARRAY_BUFFER, VBO.get());
 
 	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO.get());
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
 
+	GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, VBO.get(), vertices.size() * sizeof(Vertex), "Vertex", "Mesh");
+	GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, EBO.get(), indices.size() * sizeof(unsigned int), "uint32 index", "Mesh");
+
 	//vertex positions
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
@@ -4,6 +4,8 @@
 #include <string>
 #include <vector>
 
+#include "Bounds.h"
+#include "GLResource.h"
 #include "Shader.h"
 
 struct Vertex
@@ -25,16 +27,44 @@ class Mesh
 public:
 	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Texture> textures);
 	void Draw(Shader& shader);
-	void ClearData();
+	void DrawInstanced(Shader& shader, unsigned int instanceCount);
+	//Draws with the command at commandOffset in the bound GL_DRAW_INDIRECT_BUFFER
+	void DrawIndirect(Shader& shader, size_t commandOffset);
+
+	//Binds a buffer of per-instance model matrices to attributes 3..6
+	void setupInstanceAttributes(unsigned int instanceVBO);
+
+	const AABB& getBounds() const
+	{
+		return bounds;
+	}
+
+	const std::vector<Vertex>& getVertices() const
+	{
+		return vertices;
+	}
+
+	const std::vector<unsigned int>& getIndices() const
+	{
+		return indices;
+	}
+
+	const std::vector<Texture>& getTextures() const
+	{
+		return textures;
+	}
 
 private:
 	//Mesh data
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<Texture> textures;
+	AABB bounds;
 
-	//Render data
-	unsigned int VAO, VBO, EBO;
+	//Render data, released when the mesh is destroyed
+	GLVertexArray VAO;
+	GLBuffer VBO, EBO;
 
 	void setupMesh();
+	void bindTextures(Shader& shader);
 };
\ No newline at end of file
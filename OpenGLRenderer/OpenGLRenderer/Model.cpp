@@ -1,4 +1,6 @@
 #include "Model.h"
+#include "CpuProfiler.h"
+#include "GpuMemoryTracker.h"
 #include "stb_image.h"
 
 void Model::Draw(Shader& shader)
@@ -9,8 +11,33 @@ void Model::Draw(Shader& shader)
 	}
 }
 
+void Model::DrawInstanced(Shader& shader, unsigned int instanceCount)
+{
+	for (auto& mesh : meshes)
+	{
+		mesh.DrawInstanced(shader, instanceCount);
+	}
+}
+
+void Model::DrawIndirect(Shader& shader)
+{
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		meshes[i].DrawIndirect(shader, i * sizeof(DrawElementsIndirectCommand));
+	}
+}
+
+void Model::setupInstanceAttributes(unsigned int instanceVBO)
+{
+	for (auto& mesh : meshes)
+	{
+		mesh.setupInstanceAttributes(instanceVBO);
+	}
+}
+
 void Model::loadModel(std::string path)
 {
+	PROFILE_SCOPE("Model::loadModel");
 	Assimp::Importer importer;
 	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs);
 
@@ -31,6 +58,7 @@ void Model::processNode(aiNode* node, const aiScene* scene)
 	{
 		aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
 		meshes.push_back(processMesh(mesh, scene));
+		bounds.expand(meshes.back().getBounds());
 	}
 
 	//Process all children nodes
@@ -135,6 +163,7 @@ std::vector<Texture> Model::loadMaterialTextures(aiMaterial* mat, aiTextureType
 
 			textures.push_back(texture);
 			loaded_textures.push_back(texture);
+			owned_textures.emplace_back(texture.id);
 		}
 	}
 
@@ -167,6 +196,7 @@ unsigned int TextureFromFile(const char* path, const std::string& directory, boo
 		GLenum internalformat, format;
 		if (nrChannels == 1)
 		{
+			internalformat = GL_RED;
 			format = GL_RED;
 		}
 		else if (nrChannels == 3)
@@ -182,6 +212,9 @@ unsigned int TextureFromFile(const char* path, const std::string& directory, boo
 
 		glTexImage2D(GL_TEXTURE_2D, 0, internalformat, tWidth, tHeight, 0, format, GL_UNSIGNED_BYTE, texData);
 		glGenerateMipmap(GL_TEXTURE_2D);
+		GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, texID,
+			GpuMemoryTracker::textureBytes(tWidth, tHeight, 1, nrChannels, true),
+			nrChannels == 1 ? "R8" : nrChannels == 3 ? "SRGB8" : "SRGB8_ALPHA8", "Model texture");
 	}
 	else
 	{
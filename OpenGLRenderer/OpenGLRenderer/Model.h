@@ -17,19 +17,38 @@ public:
 	{
 		loadModel(path);
 	}
-	~Model()
+	//Takes ownership of meshes built in code, their GL objects are released with the model
+	explicit Model(std::vector<Mesh> generatedMeshes) : meshes(std::move(generatedMeshes))
 	{
-		for (auto& mesh : meshes)
+		for (const auto& mesh : meshes)
 		{
-			mesh.ClearData();
+			bounds.expand(mesh.getBounds());
 		}
 	}
 	
 	void Draw(Shader& shader);
+	void DrawInstanced(Shader& shader, unsigned int instanceCount);
+	//Expects one DrawElementsIndirectCommand per mesh in the bound indirect buffer
+	void DrawIndirect(Shader& shader);
+	void setupInstanceAttributes(unsigned int instanceVBO);
+
+	//Model space bounds of all meshes
+	const AABB& getBounds() const
+	{
+		return bounds;
+	}
+
+	const std::vector<Mesh>& getMeshes() const
+	{
+		return meshes;
+	}
 private:
 	std::vector<Mesh> meshes;
+	AABB bounds;
 	std::string directory;
 	std::vector<Texture> loaded_textures;
+	//Meshes reference textures by id, the model owns the ones it loaded
+	std::vector<GLTexture> owned_textures;
 
 	void loadModel(std::string path);
 	void processNode(aiNode* node, const aiScene* scene);
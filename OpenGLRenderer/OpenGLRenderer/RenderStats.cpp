@@ -0,0 +1,31 @@
+#include "RenderStats.h"
+
+#include <algorithm>
+
+RenderStats& RenderStats::current()
+{
+	static RenderStats stats;
+	return stats;
+}
+
+void FrameTimeHistory::push(float ms)
+{
+	m_values[m_next] = ms;
+	m_next = (m_next + 1) % SIZE;
+	m_count = std::min(m_count + 1, SIZE);
+
+	float sorted[SIZE];
+	std::copy(m_values, m_values + m_count, sorted);
+	const int p99 = std::min(m_count - 1, static_cast<int>(static_cast<float>(m_count) * 0.99f));
+	std::nth_element(sorted, sorted + p99, sorted + m_count);
+	m_p99 = sorted[p99];
+
+	float sum = 0.0f;
+	m_min = m_values[0];
+	for (int i = 0; i < m_count; i++)
+	{
+		sum += m_values[i];
+		m_min = std::min(m_min, m_values[i]);
+	}
+	m_average = sum / static_cast<float>(m_count);
+}
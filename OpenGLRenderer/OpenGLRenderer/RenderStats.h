@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+
+//GL work submitted by the CPU this frame. Call sites count what they issue; indirect draws are
+//counted with their CPU side instance counts, before any GPU culling zeroes them.
+struct RenderStats
+{
+	uint32_t drawCalls = 0;
+	uint64_t triangles = 0;
+	uint64_t vertices = 0;
+	uint32_t programBinds = 0;
+	uint32_t textureBinds = 0;
+	uint32_t uniformUploads = 0;
+	uint64_t bytesUploaded = 0;
+	uint32_t fboSwitches = 0;
+
+	void reset()
+	{
+		*this = RenderStats();
+	}
+
+	void addDraw(uint64_t indexCount, uint64_t instanceCount = 1)
+	{
+		drawCalls++;
+		vertices += indexCount * instanceCount;
+		triangles += indexCount / 3 * instanceCount;
+	}
+
+	//The counters every renderer module writes to, reset at the start of each frame
+	static RenderStats& current();
+};
+
+//Rolling window of CPU frame times for the overlay graph
+class FrameTimeHistory
+{
+public:
+	static constexpr int SIZE = 240;
+
+	void push(float ms);
+
+	//Oldest first when read from getOffset()
+	[[nodiscard]] const float* getValues() const
+	{
+		return m_values;
+	}
+
+	[[nodiscard]] int getCount() const
+	{
+		return m_count;
+	}
+
+	[[nodiscard]] int getOffset() const
+	{
+		return m_count < SIZE ? 0 : m_next;
+	}
+
+	[[nodiscard]] float getMin() const
+	{
+		return m_min;
+	}
+
+	[[nodiscard]] float getAverage() const
+	{
+		return m_average;
+	}
+
+	[[nodiscard]] float getP99() const
+	{
+		return m_p99;
+	}
+
+private:
+	float	m_values[SIZE] = {};
+	int		m_next = 0;
+	int		m_count = 0;
+	float	m_min = 0.0f;
+	float	m_average = 0.0f;
+	float	m_p99 = 0.0f;
+};
@@ -6,6 +6,7 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 
+#include "GpuMemoryTracker.h"
 #include "stb_image.h"
 
 static unsigned int loadCubemap(const std::vector<std::string>& cubeFaces)
@@ -23,6 +24,8 @@ static unsigned int loadCubemap(const std::vector<std::string>& cubeFaces)
 		{
 			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, texWidth, texHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, texData);
 			stbi_image_free(texData);
+			GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, cubemapID,
+				GpuMemoryTracker::textureBytes(texWidth, texHeight, static_cast<int>(cubeFaces.size()), 3, false), "RGB8 cube", "Skybox cubemap");
 		}
 		else
 		{
@@ -0,0 +1,208 @@
+#include "SceneBVH.h"
+
+#include <algorithm>
+
+#include "CpuProfiler.h"
+#include "JobSystem.h"
+
+void SceneBVH::insert(Entity* entity)
+{
+	m_leaves.push_back({ entity, -1, entity->transform.getRenderVersion(), entity->getWorldBounds() });
+	m_needsRebuild = true;
+}
+
+void SceneBVH::remove(Entity* entity)
+{
+	auto it = std::find_if(m_leaves.begin(), m_leaves.end(), [entity](const Leaf& leaf)
+		{
+			return leaf.entity == entity;
+		});
+
+	if (it != m_leaves.end())
+	{
+		m_leaves.erase(it);
+		m_needsRebuild = true;
+	}
+}
+
+void SceneBVH::refit()
+{
+	PROFILE_SCOPE("SceneBVH::refit");
+	if (m_needsRebuild)
+	{
+		for (auto& leaf : m_leaves)
+		{
+			leaf.version = leaf.entity->transform.getRenderVersion();
+			leaf.bounds = leaf.entity->getWorldBounds();
+		}
+
+		rebuild();
+		return;
+	}
+
+	//Leaf bounds are independent, only the propagation through shared parents is serial
+	JobSystem::get().parallelFor("SceneBVH::refitLeaves", m_leaves.size(), 256, [this](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			Leaf& leaf = m_leaves[i];
+			const uint32_t version = leaf.entity->transform.getRenderVersion();
+			leaf.moved = version != leaf.version;
+			if (leaf.moved)
+			{
+				leaf.version = version;
+				leaf.bounds = leaf.entity->getWorldBounds();
+			}
+		}
+	});
+
+	for (auto& leaf : m_leaves)
+	{
+		if (!leaf.moved)
+		{
+			continue;
+		}
+
+		m_nodes[leaf.node].bounds = leaf.bounds;
+
+		//Propagate up until a parent no longer changes
+		int parent = m_nodes[leaf.node].parent;
+		while (parent != -1)
+		{
+			Node& node = m_nodes[parent];
+			AABB merged = m_nodes[node.left].bounds;
+			merged.expand(m_nodes[node.right].bounds);
+
+			if (merged.min == node.bounds.min && merged.max == node.bounds.max)
+			{
+				break;
+			}
+
+			node.bounds = merged;
+			parent = node.parent;
+		}
+	}
+}
+
+void SceneBVH::cull(const Frustum& frustum, std::vector<Entity*>& visible, CullingStats& stats) const
+{
+	PROFILE_SCOPE("SceneBVH::cull");
+	visible.clear();
+	if (m_nodes.empty())
+	{
+		return;
+	}
+
+	int stack[64];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const int nodeIndex = stack[--stackSize];
+		const Node& node = m_nodes[nodeIndex];
+
+		stats.nodesTested++;
+		const CullResult result = frustum.testAABB(node.bounds);
+		if (result == CullResult::OUTSIDE)
+		{
+			stats.nodesCulled++;
+			continue;
+		}
+
+		//Whole subtree is inside, no need to test children
+		if (result == CullResult::INSIDE || node.leaf != -1)
+		{
+			collectLeaves(nodeIndex, visible, stats);
+			continue;
+		}
+
+		stack[stackSize++] = node.left;
+		stack[stackSize++] = node.right;
+	}
+}
+
+void SceneBVH::rebuild()
+{
+	m_needsRebuild = false;
+	m_nodes.clear();
+	if (m_leaves.empty())
+	{
+		return;
+	}
+
+	std::vector<int> leafIndices(m_leaves.size());
+	for (int i = 0; i < static_cast<int>(leafIndices.size()); i++)
+	{
+		leafIndices[i] = i;
+	}
+
+	m_nodes.reserve(m_leaves.size() * 2 - 1);
+	buildRecursive(leafIndices, 0, static_cast<int>(leafIndices.size()), -1);
+}
+
+int SceneBVH::buildRecursive(std::vector<int>& leafIndices, int begin, int end, int parent)
+{
+	const int nodeIndex = static_cast<int>(m_nodes.size());
+	m_nodes.emplace_back();
+	m_nodes[nodeIndex].parent = parent;
+
+	if (end - begin == 1)
+	{
+		const int leafIndex = leafIndices[begin];
+		m_nodes[nodeIndex].leaf = leafIndex;
+		m_nodes[nodeIndex].bounds = m_leaves[leafIndex].bounds;
+		m_leaves[leafIndex].node = nodeIndex;
+		return nodeIndex;
+	}
+
+	//Median split of leaf centers along the longest axis
+	AABB centerBounds;
+	for (int i = begin; i < end; i++)
+	{
+		centerBounds.expand(m_leaves[leafIndices[i]].bounds.getCenter());
+	}
+
+	const glm::vec3 size = centerBounds.max - centerBounds.min;
+	int axis = 0;
+	if (size.y > size.x)
+	{
+		axis = 1;
+	}
+	if (size.z > size[axis])
+	{
+		axis = 2;
+	}
+
+	const int mid = begin + (end - begin) / 2;
+	std::nth_element(leafIndices.begin() + begin, leafIndices.begin() + mid, leafIndices.begin() + end,
+		[this, axis](int a, int b)
+		{
+			return m_leaves[a].bounds.getCenter()[axis] < m_leaves[b].bounds.getCenter()[axis];
+		});
+
+	const int left = buildRecursive(leafIndices, begin, mid, nodeIndex);
+	const int right = buildRecursive(leafIndices, mid, end, nodeIndex);
+
+	Node& node = m_nodes[nodeIndex];
+	node.left = left;
+	node.right = right;
+	node.bounds = m_nodes[left].bounds;
+	node.bounds.expand(m_nodes[right].bounds);
+
+	return nodeIndex;
+}
+
+void SceneBVH::collectLeaves(int nodeIndex, std::vector<Entity*>& visible, CullingStats& stats) const
+{
+	const Node& node = m_nodes[nodeIndex];
+	if (node.leaf != -1)
+	{
+		visible.push_back(m_leaves[node.leaf].entity);
+		stats.entitiesVisible++;
+		return;
+	}
+
+	collectLeaves(node.left, visible, stats);
+	collectLeaves(node.right, visible, stats);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Bounds.h"
+#include "Entity.h"
+#include "Frustum.h"
+
+//Bounding volume hierarchy over world space entity bounds.
+//Topology is rebuilt when entities are added or removed, otherwise nodes are refitted
+//bottom-up for entities whose transform changed since the last refit.
+class SceneBVH
+{
+public:
+	void insert(Entity* entity);
+	void remove(Entity* entity);
+
+	void refit();
+	void cull(const Frustum& frustum, std::vector<Entity*>& visible, CullingStats& stats) const;
+
+	[[nodiscard]] size_t size() const
+	{
+		return m_leaves.size();
+	}
+
+	//Bounds of every entity, valid after refit()
+	[[nodiscard]] AABB getBounds() const
+	{
+		return m_nodes.empty() ? AABB() : m_nodes[0].bounds;
+	}
+
+private:
+	struct Node
+	{
+		AABB bounds;
+		int parent = -1;
+		int left = -1;
+		int right = -1;
+		int leaf = -1;
+	};
+
+	struct Leaf
+	{
+		Entity* entity;
+		int node;
+		uint32_t version;
+		AABB bounds;
+		//Set by the parallel part of refit, bounds still need propagating
+		bool moved = false;
+	};
+
+	std::vector<Node>	m_nodes;
+	std::vector<Leaf>	m_leaves;
+	bool				m_needsRebuild = false;
+
+	void rebuild();
+	int buildRecursive(std::vector<int>& leafIndices, int begin, int end, int parent);
+	void collectLeaves(int nodeIndex, std::vector<Entity*>& visible, CullingStats& stats) const;
+};
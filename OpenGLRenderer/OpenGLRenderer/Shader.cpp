@@ -1,7 +1,73 @@
 #include "Shader.h"
 
+#include "CpuProfiler.h"
+#include "RenderStats.h"
+
+namespace
+{
+	//Replaces #include "file" lines with the file's source, paths are relative to the including file
+	std::string resolveIncludes(const std::string& source, const std::string& path)
+	{
+		const size_t directoryEnd = path.find_last_of("/\\");
+		const std::string directory = directoryEnd == std::string::npos ? std::string() : path.substr(0, directoryEnd + 1);
+
+		std::string result;
+		std::istringstream lines(source);
+		std::string line;
+		while (std::getline(lines, line))
+		{
+			const size_t open = line.find('"');
+			const size_t close = line.find('"', open + 1);
+			if (line.compare(0, 8, "#include") != 0 || close == std::string::npos)
+			{
+				result += line + "\n";
+				continue;
+			}
+
+			const std::string includePath = directory + line.substr(open + 1, close - open - 1);
+			std::ifstream includeFile(includePath);
+			if (!includeFile)
+			{
+				std::cout << "ERROR::SHADER::INCLUDE_NOT_FOUND " << includePath << std::endl;
+				continue;
+			}
+			std::stringstream includeStream;
+			includeStream << includeFile.rdbuf();
+			result += resolveIncludes(includeStream.str(), includePath);
+		}
+		return result;
+	}
+
+	std::string addDefines(const std::string& source, const std::vector<std::string>& defines)
+	{
+		if (defines.empty())
+		{
+			return source;
+		}
+
+		std::string header;
+		for (const std::string& define : defines)
+		{
+			header += "#define " + define + "\n";
+		}
+
+		const size_t versionEnd = source.find('\n', source.find("#version"));
+		if (versionEnd == std::string::npos)
+		{
+			return header + source;
+		}
+		return source.substr(0, versionEnd + 1) + header + source.substr(versionEnd + 1);
+	}
+}
+
 Shader::Shader(const char* vertexPath, const char* fragmentPath)
+	: Shader(vertexPath, fragmentPath, std::vector<std::string>())
 {
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines)
+{
+	PROFILE_SCOPE("Shader compile");
 	std::string vertexCode;
 	std::string fragmentCode;
 	std::ifstream vertexFile;
@@ -23,8 +89,8 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 		vertexFile.close();
 		fragmentFile.close();
 
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+		vertexCode = addDefines(resolveIncludes(vShaderStream.str(), vertexPath), defines);
+		fragmentCode = addDefines(resolveIncludes(fShaderStream.str(), fragmentPath), defines);
 	}
 	catch (std::ifstream::failure e)
 	{
@@ -60,7 +126,8 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 	}
 
 	//Compile shader program
-	id = glCreateProgram();
+	program = GLProgram(glCreateProgram());
+	const unsigned int id = program.get();
 	glAttachShader(id, vertexShader);
 	glAttachShader(id, fragmentShader);
 	glLinkProgram(id);
@@ -77,6 +144,7 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 
 Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath)
 {
+	PROFILE_SCOPE("Shader compile");
 	std::string vertexCode;
 	std::string fragmentCode;
 	std::string geometryCode;
@@ -104,9 +172,9 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geo
 		fragmentFile.close();
 		geometryFile.close();
 
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-		geometryCode = gShaderStream.str();
+		vertexCode = resolveIncludes(vShaderStream.str(), vertexPath);
+		fragmentCode = resolveIncludes(fShaderStream.str(), fragmentPath);
+		geometryCode = resolveIncludes(gShaderStream.str(), geometryPath);
 	}
 	catch (std::ifstream::failure e)
 	{
@@ -153,7 +221,8 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geo
 	}
 
 	//Compile shader program
-	id = glCreateProgram();
+	program = GLProgram(glCreateProgram());
+	const unsigned int id = program.get();
 	glAttachShader(id, vertexShader);
 	glAttachShader(id, fragmentShader);
 	glAttachShader(id, geometryShader);
@@ -170,67 +239,155 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath, const char* geo
 	glDeleteShader(geometryShader);
 }
 
+Shader::Shader(const char* computePath)
+{
+	PROFILE_SCOPE("Shader compile");
+	std::string computeCode;
+	std::ifstream computeFile;
+
+	computeFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+	//Read shader file
+	try
+	{
+		computeFile.open(computePath);
+		std::stringstream cShaderStream;
+
+		cShaderStream << computeFile.rdbuf();
+
+		computeFile.close();
+
+		computeCode = resolveIncludes(cShaderStream.str(), computePath);
+	}
+	catch (std::ifstream::failure e)
+	{
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+	}
+
+	const char* cShaderCode = computeCode.c_str();
+
+	//Compile shader
+	unsigned int computeShader;
+	computeShader = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(computeShader, 1, &cShaderCode, nullptr);
+	glCompileShader(computeShader);
+
+	int  success;
+	char infoLog[512];
+	glGetShaderiv(computeShader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(computeShader, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+	}
+
+	//Compile shader program
+	program = GLProgram(glCreateProgram());
+	const unsigned int id = program.get();
+	glAttachShader(id, computeShader);
+	glLinkProgram(id);
+
+	glGetProgramiv(id, GL_LINK_STATUS, &success);
+	if (!success) {
+		glGetProgramInfoLog(id, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::ShaderProgram::COMPILATION_FAILED\n" << infoLog << std::endl;
+	}
+
+	glDeleteShader(computeShader);
+}
+
 void Shader::use() const
 {
-	glUseProgram(id);
+	RenderStats::current().programBinds++;
+	glUseProgram(program.get());
 }
 
 void Shader::setBool(const std::string& name, bool value) const
 {
-	glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+	RenderStats::current().uniformUploads++;
+	glUniform1i(glGetUniformLocation(program.get(), name.c_str()), value);
 }
 void Shader::setFloat(const std::string& name, float value) const
 {
-	glUniform1f(glGetUniformLocation(id, name.c_str()), value);
+	RenderStats::current().uniformUploads++;
+	glUniform1f(glGetUniformLocation(program.get(), name.c_str()), value);
 }
 
 void Shader::setVec2(const std::string& name, const glm::vec2& value) const
 {
-	glUniform2fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+	RenderStats::current().uniformUploads++;
+	glUniform2fv(glGetUniformLocation(program.get(), name.c_str()), 1, &value[0]);
 }
 
 void Shader::setVec2(const std::string& name, float x, float y) const
 {
-	glUniform2f(glGetUniformLocation(id, name.c_str()), x, y);
+	RenderStats::current().uniformUploads++;
+	glUniform2f(glGetUniformLocation(program.get(), name.c_str()), x, y);
+}
+
+void Shader::setIVec2(const std::string& name, int x, int y) const
+{
+	RenderStats::current().uniformUploads++;
+	glUniform2i(glGetUniformLocation(program.get(), name.c_str()), x, y);
+}
+
+void Shader::setIVec3(const std::string& name, int x, int y, int z) const
+{
+	RenderStats::current().uniformUploads++;
+	glUniform3i(glGetUniformLocation(program.get(), name.c_str()), x, y, z);
 }
 
 void Shader::setVec3(const std::string& name, const glm::vec3& value) const
 {
-	glUniform3fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+	RenderStats::current().uniformUploads++;
+	glUniform3fv(glGetUniformLocation(program.get(), name.c_str()), 1, &value[0]);
 }
 
 void Shader::setVec3(const std::string& name, float x, float y, float z) const
 {
-	glUniform3f(glGetUniformLocation(id, name.c_str()), x, y, z);
+	RenderStats::current().uniformUploads++;
+	glUniform3f(glGetUniformLocation(program.get(), name.c_str()), x, y, z);
 }
 
 void Shader::setVec4(const std::string& name, const glm::vec4& value) const
 {
-	glUniform4fv(glGetUniformLocation(id, name.c_str()), 1, &value[0]);
+	RenderStats::current().uniformUploads++;
+	glUniform4fv(glGetUniformLocation(program.get(), name.c_str()), 1, &value[0]);
 }
 
 void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
 {
-	glUniform4f(glGetUniformLocation(id, name.c_str()), x, y, z, w);
+	RenderStats::current().uniformUploads++;
+	glUniform4f(glGetUniformLocation(program.get(), name.c_str()), x, y, z, w);
 }
 
 void Shader::setMat2(const std::string& name, const glm::mat2& mat) const
 {
-	glUniformMatrix2fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	RenderStats::current().uniformUploads++;
+	glUniformMatrix2fv(glGetUniformLocation(program.get(), name.c_str()), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setMat3(const std::string& name, const glm::mat3& mat) const
 {
-	glUniformMatrix3fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	RenderStats::current().uniformUploads++;
+	glUniformMatrix3fv(glGetUniformLocation(program.get(), name.c_str()), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setMat4(const std::string& name, const glm::mat4& mat) const
 {
-	glUniformMatrix4fv(glGetUniformLocation(id, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+	RenderStats::current().uniformUploads++;
+	glUniformMatrix4fv(glGetUniformLocation(program.get(), name.c_str()), 1, GL_FALSE, &mat[0][0]);
 }
 
 void Shader::setInt(const std::string& name, int value) const
 {
-	glUniform1i(glGetUniformLocation(id, name.c_str()), value);
+	RenderStats::current().uniformUploads++;
+	glUniform1i(glGetUniformLocation(program.get(), name.c_str()), value);
+}
+
+void Shader::setUint(const std::string& name, unsigned int value) const
+{
+	RenderStats::current().uniformUploads++;
+	glUniform1ui(glGetUniformLocation(program.get(), name.c_str()), value);
 }
 
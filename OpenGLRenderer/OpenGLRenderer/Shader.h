@@ -1,8 +1,10 @@
 #pragma once
 
-#include <glad/glad.h>
+#include "GLExtensions.h"
+#include "GLResource.h"
 
 #include <string>
+#include <vector>
 #include <fstream>
 #include <sstream>
 #include <iostream>
@@ -15,16 +17,23 @@ class Shader
 {
 public:
 	Shader(const char* vertexPath, const char* fragmentPath);
+	//Permutation of a program, each entry becomes a #define after the #version line
+	Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines);
 	Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath);
+	//Compute program, requires GL 4.3
+	explicit Shader(const char* computePath);
 
 	void use() const;
 
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, int value) const;
+	void setUint(const std::string& name, unsigned int value) const;
 	void setFloat(const std::string& name, float value) const;
 
     void setVec2(const std::string& name, const glm::vec2& value) const;
     void setVec2(const std::string& name, float x, float y) const;
+    void setIVec2(const std::string& name, int x, int y) const;
+    void setIVec3(const std::string& name, int x, int y, int z) const;
     void setVec3(const std::string& name, const glm::vec3& value) const;
     void setVec3(const std::string& name, float x, float y, float z) const;
     void setVec4(const std::string& name, const glm::vec4& value) const;
@@ -36,11 +45,11 @@ public:
 
 	[[nodiscard]] unsigned int getID() const
 	{
-		return id;
+		return program.get();
 	}
 
 	
 
 private:
-	unsigned int id;
+	GLProgram program;
 };
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;   // the position variable has attribute position 0
+
+out vec3 localPos;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+void main()
+{
+    localPos = aPos;
+    gl_Position = projection * view * vec4(aPos, 1.0);
+}
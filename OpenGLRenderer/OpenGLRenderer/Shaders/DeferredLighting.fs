@@ -0,0 +1,55 @@
+#version 330 core
+
+#include "Lighting.glsl"
+
+out vec4 FragColor;
+
+uniform sampler2D _GAlbedoSpecular;
+uniform sampler2D _GNormalRoughness;
+uniform sampler2D _GDepth;
+uniform mat4 _InvViewProjection;
+
+uniform DirLight _DirLight;
+uniform vec3 _ViewPos;
+
+vec3 DecodeNormal(vec2 encoded)
+{
+    vec2 f = encoded * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(_GDepth, coord, 0).r;
+
+    //Background keeps the clear color, the skybox is drawn afterwards
+    if(depth >= 1.0)
+    {
+        discard;
+    }
+
+    vec4 albedoSpecular = texelFetch(_GAlbedoSpecular, coord, 0);
+    vec4 normalRoughness = texelFetch(_GNormalRoughness, coord, 0);
+
+    vec4 ndc = vec4(vec2(coord) + 0.5, depth, 1.0);
+    ndc.xy /= vec2(textureSize(_GDepth, 0));
+    ndc = ndc * 2.0 - 1.0;
+    vec4 worldPos = _InvViewProjection * ndc;
+
+    Surface surface;
+    surface.worldPos = worldPos.xyz / worldPos.w;
+    surface.normal = DecodeNormal(normalRoughness.xy);
+    surface.albedo = albedoSpecular.rgb;
+    surface.specular = vec3(albedoSpecular.a);
+    surface.roughness = normalRoughness.z;
+    //Inverse of the shininess to roughness mapping in GBuffer.fs
+    surface.shiness = 2.0 / max(surface.roughness * surface.roughness, 1e-4) - 2.0;
+
+    vec3 viewDir = normalize(_ViewPos - surface.worldPos);
+
+    FragColor = vec4(CalcLighting(_DirLight, surface, viewDir, depth), 1.0);
+}
@@ -5,7 +5,9 @@ in vec3 Normal;
 in vec3 WorldPos;
 in vec2 TexCoord;
 
-uniform samplerCube _Skybox;
+uniform samplerCube _PrefilterMap;
+uniform float _PrefilterMaxLod;
+uniform float _Roughness;
 uniform vec3 _ViewPos;
 
 
@@ -13,6 +15,5 @@ void main()
 {
     vec3 I = normalize(WorldPos - _ViewPos);
     vec3 R = reflect(I, normalize(Normal));
-    FragColor = vec4(texture(_Skybox, R).rgb, 1.0);
+    FragColor = vec4(textureLod(_PrefilterMap, R, _Roughness * _PrefilterMaxLod).rgb, 1.0);
 }
-
@@ -0,0 +1,49 @@
+#version 330 core
+
+struct Material
+{
+    vec3 ambient;
+    sampler2D texture_diffuse1;
+    sampler2D texture_diffuse2;
+    sampler2D texture_diffuse3;
+    sampler2D texture_specular1;
+    sampler2D texture_specular2;
+    float shiness;
+};
+
+layout (location = 0) out vec4 GAlbedoSpecular;
+layout (location = 1) out vec4 GNormalRoughness;
+
+in VS_OUT
+{
+    vec3 Normal;
+    vec3 WorldPos;
+    vec2 TexCoord;
+} fs_in;
+
+uniform Material _Material;
+
+vec2 OctWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+//Octahedral encoding into [0, 1]
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+    return n.xy * 0.5 + 0.5;
+}
+
+void main()
+{
+    vec3 albedo = vec3(texture(_Material.texture_diffuse1, fs_in.TexCoord));
+    float specular = texture(_Material.texture_specular1, fs_in.TexCoord).r;
+
+    //Same Blinn-Phong shininess to GGX roughness mapping as the forward path
+    float roughness = clamp(sqrt(2.0 / (_Material.shiness + 2.0)), 0.0, 1.0);
+
+    GAlbedoSpecular = vec4(albedo, specular);
+    GNormalRoughness = vec4(EncodeNormal(normalize(fs_in.Normal)), roughness, 1.0);
+}
@@ -0,0 +1,46 @@
+#version 330 core
+
+out float FragDepth;
+
+uniform sampler2D _Source;
+uniform bool _Downsample;
+uniform int _SourceLevel;
+uniform ivec2 _SourceSize;
+
+float fetchDepth(ivec2 coord)
+{
+    return texelFetch(_Source, min(coord, _SourceSize - 1), _SourceLevel).r;
+}
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    if(!_Downsample)
+    {
+        FragDepth = fetchDepth(coord);
+        return;
+    }
+
+    //Keep the farthest depth of the 2x2 footprint
+    ivec2 src = coord * 2;
+    float depth = max(max(fetchDepth(src), fetchDepth(src + ivec2(1, 0))),
+                      max(fetchDepth(src + ivec2(0, 1)), fetchDepth(src + ivec2(1, 1))));
+
+    //Odd source sizes leave an extra row/column for the last texel
+    bool extraX = (_SourceSize.x & 1) != 0 && coord.x == _SourceSize.x / 2 - 1;
+    bool extraY = (_SourceSize.y & 1) != 0 && coord.y == _SourceSize.y / 2 - 1;
+    if(extraX)
+    {
+        depth = max(depth, max(fetchDepth(src + ivec2(2, 0)), fetchDepth(src + ivec2(2, 1))));
+    }
+    if(extraY)
+    {
+        depth = max(depth, max(fetchDepth(src + ivec2(0, 2)), fetchDepth(src + ivec2(1, 2))));
+    }
+    if(extraX && extraY)
+    {
+        depth = max(depth, fetchDepth(src + ivec2(2, 2)));
+    }
+
+    FragDepth = depth;
+}
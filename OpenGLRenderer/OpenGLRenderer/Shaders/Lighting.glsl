@@ -0,0 +1,336 @@
+//Lighting shared by the forward (ShadowBlinnPhong.fs) and deferred (DeferredLighting.fs) paths.
+//Spliced in by Shader at the #include line, so permutation defines are already set.
+
+struct DirLight
+{
+    vec3 direction;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+//Everything the light functions need about the shaded point
+struct Surface
+{
+    vec3 worldPos;
+    vec3 normal;
+    vec3 albedo;
+    vec3 specular;
+    float roughness;
+    float shiness;
+};
+
+//Shadow atlas shared by cascades and local lights, see ShadowAtlas.
+//Permutations: SHADOW_KERNEL_SIZE taps of a rotated Poisson disk, SHADOW_PCSS for contact hardening
+#ifndef SHADOW_KERNEL_SIZE
+#define SHADOW_KERNEL_SIZE 8
+#endif
+uniform sampler2DShadow _ShadowAtlas;
+uniform float _ShadowAtlasSize;
+#ifdef SHADOW_PCSS
+uniform sampler2D _ShadowAtlasDepth;
+uniform float _ShadowPenumbraScale;
+#endif
+
+//Ordered so every prefix is evenly spread
+const vec2 POISSON_DISK[32] = vec2[](
+    vec2(0.0211, -0.0386), vec2(-0.9945, -0.0651), vec2(0.4996, 0.8293), vec2(0.9809, 0.0004),
+    vec2(-0.5307, 0.7585), vec2(-0.2601, -0.8298), vec2(0.6489, -0.6664), vec2(-0.0527, 0.4883),
+    vec2(-0.6060, -0.4714), vec2(0.2037, -0.8538), vec2(0.3768, 0.2538), vec2(0.3159, -0.4099),
+    vec2(-0.8096, 0.4945), vec2(0.6146, -0.1015), vec2(-0.2821, 0.1507), vec2(-0.4281, -0.1718),
+    vec2(-0.2180, -0.4890), vec2(0.8091, 0.2896), vec2(0.9207, -0.3280), vec2(-0.4794, 0.4087),
+    vec2(-0.2126, 0.7954), vec2(-0.6616, 0.0365), vec2(0.2775, 0.5461), vec2(0.1978, 0.8364),
+    vec2(0.6932, 0.6035), vec2(0.3222, -0.0994), vec2(-0.5694, -0.7613), vec2(-0.9417, 0.2360),
+    vec2(0.0599, -0.5703), vec2(-0.8806, -0.3312), vec2(0.0816, 0.2385), vec2(0.6306, -0.3827)
+);
+
+//Cascaded shadow map, see Light::updateCascades
+#define MAX_CASCADES 4
+uniform mat4 _CascadeMatrices[MAX_CASCADES];
+uniform float _CascadeSplits[MAX_CASCADES];
+uniform vec4 _CascadeTiles[MAX_CASCADES];
+uniform int _CascadeCount;
+
+//Point and spot light shadows, see LocalLightShadows
+#define MAX_SHADOW_TILES 64
+uniform vec4 _ShadowTiles[MAX_SHADOW_TILES];
+uniform float _LocalShadowNear;
+
+//Cube face basis, matches FACE_FORWARD and FACE_UP in LocalLightShadows.cpp
+const vec3 CUBE_FORWARD[6] = vec3[](vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0),
+                                    vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0));
+const vec3 CUBE_UP[6] = vec3[](vec3(0.0, -1.0, 0.0), vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, 1.0),
+                               vec3(0.0, 0.0, -1.0), vec3(0.0, -1.0, 0.0), vec3(0.0, -1.0, 0.0));
+
+//Image based lighting
+uniform samplerCube _IrradianceMap;
+uniform samplerCube _PrefilterMap;
+uniform sampler2D _BrdfLUT;
+uniform float _PrefilterMaxLod;
+
+//Clustered point and spot lights, see ClusteredLighting
+uniform samplerBuffer _LightData;
+uniform usamplerBuffer _ClusterGrid;
+uniform usamplerBuffer _LightIndices;
+uniform ivec3 _ClusterDims;
+uniform vec2 _ClusterScreenScale;
+uniform vec2 _ClusterDepthParams;
+uniform float _Near;
+uniform float _Far;
+
+float LinearizeDepth(float depth)
+{
+    float z = depth * 2.0 - 1.0; // back to NDC
+    return (2.0 * _Near * _Far) / (_Far + _Near - z * (_Far - _Near));
+}
+
+int ClusterIndex(float depth)
+{
+    float slice = log(LinearizeDepth(depth)) * _ClusterDepthParams.x + _ClusterDepthParams.y;
+    ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy * _ClusterScreenScale), int(slice));
+    cluster = clamp(cluster, ivec3(0), _ClusterDims - 1);
+    return (cluster.z * _ClusterDims.y + cluster.y) * _ClusterDims.x + cluster.x;
+}
+
+float InterleavedGradientNoise(vec2 position)
+{
+    return fract(52.9829189 * fract(dot(position, vec2(0.06711056, 0.00583715))));
+}
+
+//Rotated Poisson disk of radius texels, each tap is a bilinear 2x2 hardware comparison.
+//Returns the shadowed fraction
+float FilterShadowTile(vec4 tile, vec2 atlasUV, float currentDepth, float radius)
+{
+    float texelSize = 1.0 / _ShadowAtlasSize;
+    vec2 tileMin = tile.xy + texelSize;
+    vec2 tileMax = tile.xy + tile.zw - texelSize;
+
+    float angle = InterleavedGradientNoise(gl_FragCoord.xy) * 6.2831853;
+    mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+
+    float lit = 0.0;
+    for(int i = 0; i < SHADOW_KERNEL_SIZE; i++)
+    {
+        vec2 tapUV = clamp(atlasUV + rotation * POISSON_DISK[i] * radius * texelSize, tileMin, tileMax);
+        lit += texture(_ShadowAtlas, vec3(tapUV, currentDepth));
+    }
+    return 1.0 - lit / float(SHADOW_KERNEL_SIZE);
+}
+
+//uv and depth are in the tile's [0, 1] shadow space
+float SampleShadowTile(vec4 tile, vec2 uv, float currentDepth)
+{
+    vec2 atlasUV = tile.xy + uv * tile.zw;
+#ifdef SHADOW_PCSS
+    //Blocker search, the penumbra widens with the distance between receiver and average blocker
+    float texelSize = 1.0 / _ShadowAtlasSize;
+    vec2 tileMin = tile.xy + texelSize;
+    vec2 tileMax = tile.xy + tile.zw - texelSize;
+    float blockerDepth = 0.0;
+    float blockers = 0.0;
+    for(int i = 0; i < 16; i++)
+    {
+        vec2 tapUV = clamp(atlasUV + POISSON_DISK[i] * 8.0 * texelSize, tileMin, tileMax);
+        float depth = texture(_ShadowAtlasDepth, tapUV).r;
+        if(depth < currentDepth)
+        {
+            blockerDepth += depth;
+            blockers += 1.0;
+        }
+    }
+    if(blockers == 0.0)
+    {
+        return 0.0;
+    }
+    blockerDepth /= blockers;
+    float radius = clamp((currentDepth - blockerDepth) / blockerDepth * _ShadowPenumbraScale, 1.0, 8.0);
+    return FilterShadowTile(tile, atlasUV, currentDepth, radius);
+#else
+    return FilterShadowTile(tile, atlasUV, currentDepth, 1.5);
+#endif
+}
+
+//Window depth of a view space distance for the local light projections
+float PerspectiveDepth(float depth, float far)
+{
+    float near = _LocalShadowNear;
+    float ndcDepth = (far + near) / (far - near) - 2.0 * far * near / ((far - near) * depth);
+    return ndcDepth * 0.5 + 0.5;
+}
+
+float PointShadow(int firstTile, vec3 lightPos, float range, vec3 worldPos, vec3 normal)
+{
+    vec3 toFragment = worldPos - lightPos;
+    vec3 axis = abs(toFragment);
+    int face;
+    if(axis.x >= axis.y && axis.x >= axis.z)
+    {
+        face = toFragment.x > 0.0 ? 0 : 1;
+    }
+    else if(axis.y >= axis.z)
+    {
+        face = toFragment.y > 0.0 ? 2 : 3;
+    }
+    else
+    {
+        face = toFragment.z > 0.0 ? 4 : 5;
+    }
+    vec4 tile = _ShadowTiles[firstTile + face];
+
+    //Normal offset by about a texel at this distance instead of a depth bias
+    float texelWorld = 2.0 * length(toFragment) / (tile.z * _ShadowAtlasSize);
+    toFragment += normal * texelWorld * 1.5;
+
+    //Same view basis as glm::lookAt with a 90 degree perspective
+    vec3 forward = CUBE_FORWARD[face];
+    vec3 right = normalize(cross(forward, CUBE_UP[face]));
+    vec3 up = cross(right, forward);
+    float depth = dot(forward, toFragment);
+    vec2 ndc = vec2(dot(right, toFragment), dot(up, toFragment)) / depth;
+
+    return SampleShadowTile(tile, ndc * 0.5 + 0.5, PerspectiveDepth(depth, range));
+}
+
+float SpotShadow(int tileIndex, vec3 lightPos, vec3 direction, float outerCutOff, float range, vec3 worldPos, vec3 normal)
+{
+    vec4 tile = _ShadowTiles[tileIndex];
+    vec3 toFragment = worldPos - lightPos;
+    float tanHalfAngle = sqrt(1.0 - outerCutOff * outerCutOff) / outerCutOff;
+
+    float texelWorld = 2.0 * length(toFragment) * tanHalfAngle / (tile.z * _ShadowAtlasSize);
+    toFragment += normal * texelWorld * 1.5;
+
+    //Same basis as the glm::lookAt in LocalLightShadows::update
+    vec3 up = abs(direction.y) > 0.99 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(direction, up));
+    up = cross(right, direction);
+    float depth = dot(direction, toFragment);
+    vec2 ndc = vec2(dot(right, toFragment), dot(up, toFragment)) / (depth * tanHalfAngle);
+
+    return SampleShadowTile(tile, ndc * 0.5 + 0.5, PerspectiveDepth(depth, range));
+}
+
+float ShadowCalculation(vec3 worldPos, float viewDepth, vec3 normal, vec3 lightDir)
+{
+    //First cascade whose split contains the fragment
+    int cascade = _CascadeCount - 1;
+    for(int i = 0; i < _CascadeCount; i++)
+    {
+        if(viewDepth < _CascadeSplits[i])
+        {
+            cascade = i;
+            break;
+        }
+    }
+    vec4 fragPosLightSpace = _CascadeMatrices[cascade] * vec4(worldPos, 1.0);
+
+    //Perform perspective divide
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+    //Tranform to [0, 1] range
+    projCoords = projCoords * 0.5 + 0.5;
+    if(projCoords.z > 1.0 || any(lessThan(projCoords.xy, vec2(0.0))) || any(greaterThan(projCoords.xy, vec2(1.0))))
+    {
+        return 0.0;
+    }
+
+    float bias = max(0.002 * (1.0 - dot(normal, lightDir)), 0.005);
+    return SampleShadowTile(_CascadeTiles[cascade], projCoords.xy, projCoords.z - bias);
+}
+
+vec3 CalcDirLight(DirLight light, Surface surface, vec3 viewDir)
+{
+    vec3 lightDir = normalize(-light.direction);
+
+    //diffuse
+    float diff = max(dot(surface.normal, -lightDir), 0.0f);
+    //Specular
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(viewDir, halfwayDir), 0.0), surface.shiness);
+    //Combine result
+    vec3 diffuse = light.diffuse * diff * surface.albedo;
+    vec3 specular = spec * surface.specular * light.specular;
+    return (diffuse + specular);
+}
+
+vec3 CalcAmbient(Surface surface, vec3 viewDir)
+{
+    float NdotV = max(dot(surface.normal, viewDir), 0.0);
+
+    vec3 diffuse = texture(_IrradianceMap, surface.normal).rgb * surface.albedo;
+
+    vec3 R = reflect(-viewDir, surface.normal);
+    vec3 prefiltered = textureLod(_PrefilterMap, R, surface.roughness * _PrefilterMaxLod).rgb;
+    vec2 envBRDF = texture(_BrdfLUT, vec2(NdotV, surface.roughness)).rg;
+    vec3 specular = prefiltered * (surface.specular * envBRDF.x + envBRDF.y);
+
+    return diffuse + specular;
+}
+
+vec3 CalcLocalLight(int index, Surface surface, vec3 viewDir)
+{
+    //Layout written by ClusteredLighting::update
+    vec4 positionRange = texelFetch(_LightData, index * 5);
+    vec4 diffuseType = texelFetch(_LightData, index * 5 + 1);
+    vec4 specularCutOff = texelFetch(_LightData, index * 5 + 2);
+    vec4 directionOuterCutOff = texelFetch(_LightData, index * 5 + 3);
+    vec4 attenuationShadow = texelFetch(_LightData, index * 5 + 4);
+
+    vec3 toLight = positionRange.xyz - surface.worldPos;
+    float distance = length(toLight);
+    vec3 lightDir = toLight / distance;
+
+    //diffuse
+    float diff = max(dot(surface.normal, lightDir), 0.0);
+    //specular
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(surface.normal, halfwayDir), 0.0), surface.shiness);
+    //attenuation, windowed to reach zero at the cluster assignment range
+    float attenuation = 1.0 / (attenuationShadow.x + attenuationShadow.y * distance +
+                                    attenuationShadow.z * (distance * distance));
+    float falloff = clamp(1.0 - pow(distance / positionRange.w, 4.0), 0.0, 1.0);
+    attenuation *= falloff * falloff;
+
+    //spot cone
+    if(diffuseType.w > 0.5)
+    {
+        float theta = dot(directionOuterCutOff.xyz, -lightDir);
+        float epsilon = specularCutOff.w - directionOuterCutOff.w;
+        attenuation *= clamp((theta - directionOuterCutOff.w) / epsilon, 0.0, 1.0);
+    }
+
+    //shadow, first atlas tile or -1 for unshadowed lights
+    if(attenuationShadow.w >= 0.0)
+    {
+        int tile = int(attenuationShadow.w);
+        float shadow = diffuseType.w > 0.5
+            ? SpotShadow(tile, positionRange.xyz, directionOuterCutOff.xyz, directionOuterCutOff.w, positionRange.w, surface.worldPos, surface.normal)
+            : PointShadow(tile, positionRange.xyz, positionRange.w, surface.worldPos, surface.normal);
+        attenuation *= 1.0 - shadow;
+    }
+
+    vec3 diffuse = diffuseType.rgb * diff * surface.albedo * attenuation;
+    vec3 specular = spec * surface.specular * specularCutOff.rgb * attenuation;
+    return (diffuse + specular);
+}
+
+//Directional light with cascaded shadows, ambient, then the point and spot lights of the cluster.
+//depth is the window depth of the surface
+vec3 CalcLighting(DirLight light, Surface surface, vec3 viewDir, float depth)
+{
+    vec3 result = CalcDirLight(light, surface, viewDir);
+    vec3 ambient = light.ambient * CalcAmbient(surface, viewDir);
+
+    //Shadow calculation
+    vec3 lightDir = normalize(-light.direction);
+    float shadow = ShadowCalculation(surface.worldPos, LinearizeDepth(depth), surface.normal, lightDir);
+    result = (ambient + (1.0 - shadow) * result);
+
+    uvec2 cluster = texelFetch(_ClusterGrid, ClusterIndex(depth)).rg;
+    for(uint i = 0u; i < cluster.y; i++)
+    {
+        int index = int(texelFetch(_LightIndices, int(cluster.x + i)).r);
+        result += CalcLocalLight(index, surface, viewDir);
+    }
+    return result;
+}
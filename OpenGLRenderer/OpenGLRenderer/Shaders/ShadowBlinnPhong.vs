@@ -8,13 +8,14 @@ out VS_OUT
     vec3 Normal;
     vec3 WorldPos;
     vec2 TexCoord;
-    vec4 FragPosLightSpace;
 } vs_out;
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+
+//Required for the GL_EQUAL depth test after the pre-pass
+invariant gl_Position;
 
 void main()
 {
@@ -23,5 +24,4 @@ void main()
     
     vs_out.Normal = mat3(transpose(inverse(model))) * aNormal;
     vs_out.TexCoord = aTexCoord;
-    vs_out.FragPosLightSpace = lightSpaceMatrix * vec4(vs_out.WorldPos, 1.0);
 }
@@ -0,0 +1,41 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;   // the position variable has attribute position 0
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in uint aDrawID;
+
+struct DrawData
+{
+    mat4 model;
+    uvec4 material;
+    vec4 boundsMin;
+    vec4 boundsMax;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBuffer
+{
+    DrawData draws[];
+};
+
+out VS_OUT
+{
+    vec3 Normal;
+    vec3 WorldPos;
+    vec2 TexCoord;
+} vs_out;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+//Required for the GL_EQUAL depth test after the pre-pass
+invariant gl_Position;
+
+void main()
+{
+    mat4 model = draws[aDrawID].model;
+    vs_out.WorldPos = vec3(model * vec4(aPos, 1.0));
+    gl_Position = projection * view * vec4(vs_out.WorldPos, 1.0);
+    
+    vs_out.Normal = mat3(transpose(inverse(model))) * aNormal;
+    vs_out.TexCoord = aTexCoord;
+}
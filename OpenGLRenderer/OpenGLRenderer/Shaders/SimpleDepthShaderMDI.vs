@@ -0,0 +1,23 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;   // the position variable has attribute position 0
+layout (location = 3) in uint aDrawID;
+
+struct DrawData
+{
+    mat4 model;
+    uvec4 material;
+    vec4 boundsMin;
+    vec4 boundsMax;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBuffer
+{
+    DrawData draws[];
+};
+
+uniform mat4 lightSpace;
+
+void main()
+{
+    gl_Position = lightSpace * draws[aDrawID].model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,349 @@
+#include "ShadowAtlas.h"
+
+#include <algorithm>
+
+#include "GpuMemoryTracker.h"
+#include "RenderStats.h"
+
+ShadowAtlas::ShadowAtlas(uint32_t texelBudget)
+	: m_texelBudget(texelBudget)
+{
+	glGenTextures(1, &m_texture);
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SIZE, SIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	//Depth formats are padded to 32 bits by common drivers
+	GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, m_texture,
+		GpuMemoryTracker::textureBytes(SIZE, SIZE, 1, 4, false), "DEPTH24", "ShadowAtlas");
+
+	//Linear filtering with comparison returns the weighted result of four depth tests
+	glGenSamplers(1, &m_compareSampler);
+	glSamplerParameteri(m_compareSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glSamplerParameteri(m_compareSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(m_compareSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(m_compareSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(m_compareSampler, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glSamplerParameteri(m_compareSampler, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+	glGenSamplers(1, &m_depthSampler);
+	glSamplerParameteri(m_depthSampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glSamplerParameteri(m_depthSampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glSamplerParameteri(m_depthSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(m_depthSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glGenFramebuffers(1, &m_FBO);
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, m_texture, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "ERROR::SHADOW_ATLAS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+	}
+
+	//Tiles keep their contents between frames, so the atlas is cleared once here
+	glClear(GL_DEPTH_BUFFER_BIT);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	Node root;
+	root.origin = glm::ivec2(0);
+	root.size = SIZE;
+	m_nodes.push_back(root);
+	m_stats.texelBudget = m_texelBudget;
+}
+
+ShadowAtlas::~ShadowAtlas()
+{
+	glDeleteFramebuffers(1, &m_FBO);
+	glDeleteSamplers(1, &m_compareSampler);
+	glDeleteSamplers(1, &m_depthSampler);
+	glDeleteTextures(1, &m_texture);
+	GpuMemoryTracker::get().release(GpuResourceKind::TEXTURE, m_texture);
+}
+
+std::vector<std::string> ShadowAtlas::getFilterDefines(ShadowFilter filter, int kernelSize)
+{
+	std::vector<std::string> defines;
+	defines.push_back("SHADOW_KERNEL_SIZE " + std::to_string(std::clamp(kernelSize, 1, MAX_KERNEL_SIZE)));
+	if (filter == ShadowFilter::PCSS)
+	{
+		defines.push_back("SHADOW_PCSS");
+	}
+	return defines;
+}
+
+void ShadowAtlas::beginFrame()
+{
+	m_requests.clear();
+}
+
+void ShadowAtlas::request(uint64_t key, int count, int desiredSize, float importance)
+{
+	int size = MIN_TILE_SIZE;
+	while (size < SIZE && size < desiredSize)
+	{
+		size *= 2;
+	}
+	m_requests.push_back({ key, count, size, importance });
+}
+
+void ShadowAtlas::allocate()
+{
+	std::sort(m_requests.begin(), m_requests.end(), [](const Request& a, const Request& b)
+	{
+		return a.importance > b.importance;
+	});
+
+	//Keep the current request while the desired size is a single level away
+	for (Request& request : m_requests)
+	{
+		auto it = m_allocations.find(request.key);
+		if (it != m_allocations.end() && static_cast<int>(it->second.tiles.size()) == request.count &&
+			(request.size == it->second.requestedSize * 2 || request.size * 2 == it->second.requestedSize))
+		{
+			request.size = it->second.requestedSize;
+		}
+	}
+
+	//Fit the budget, halving the least important requests first
+	uint64_t texels = 0;
+	for (const Request& request : m_requests)
+	{
+		texels += static_cast<uint64_t>(request.count) * request.size * request.size;
+	}
+	for (auto it = m_requests.rbegin(); it != m_requests.rend() && texels > m_texelBudget; ++it)
+	{
+		while (it->size > MIN_TILE_SIZE && texels > m_texelBudget)
+		{
+			texels -= static_cast<uint64_t>(it->count) * it->size * it->size * 3 / 4;
+			it->size /= 2;
+		}
+	}
+
+	m_stats.dropped = 0;
+	while (!m_requests.empty() && texels > m_texelBudget)
+	{
+		const Request& last = m_requests.back();
+		texels -= static_cast<uint64_t>(last.count) * last.size * last.size;
+		m_requests.pop_back();
+		m_stats.dropped++;
+	}
+
+	//Release tiles that are no longer requested or changed size
+	std::unordered_map<uint64_t, const Request*> requested;
+	for (const Request& request : m_requests)
+	{
+		requested[request.key] = &request;
+	}
+	for (auto it = m_allocations.begin(); it != m_allocations.end();)
+	{
+		auto found = requested.find(it->first);
+		if (found == requested.end() || found->second->size != it->second.requestedSize ||
+			found->second->count != static_cast<int>(it->second.tiles.size()))
+		{
+			for (const glm::ivec4& tile : it->second.tiles)
+			{
+				freeTile(0, tile);
+			}
+			it = m_allocations.erase(it);
+		}
+		else
+		{
+			it->second.reallocated = false;
+			++it;
+		}
+	}
+
+	//Assign new groups largest importance first, shrinking when the quadtree is fragmented
+	m_stats.reallocated = 0;
+	for (const Request& request : m_requests)
+	{
+		if (m_allocations.count(request.key))
+		{
+			continue;
+		}
+
+		Allocation allocation;
+		for (int size = request.size; size >= MIN_TILE_SIZE && allocation.tiles.empty(); size /= 2)
+		{
+			for (int i = 0; i < request.count; i++)
+			{
+				glm::ivec4 tile;
+				if (!allocateTile(0, size, tile))
+				{
+					break;
+				}
+				allocation.tiles.push_back(tile);
+			}
+
+			if (static_cast<int>(allocation.tiles.size()) < request.count)
+			{
+				for (const glm::ivec4& tile : allocation.tiles)
+				{
+					freeTile(0, tile);
+				}
+				allocation.tiles.clear();
+			}
+			allocation.size = size;
+		}
+
+		if (allocation.tiles.empty())
+		{
+			m_stats.dropped++;
+			continue;
+		}
+		allocation.requestedSize = request.size;
+		allocation.reallocated = true;
+		m_allocations.emplace(request.key, std::move(allocation));
+		m_stats.reallocated++;
+	}
+
+	m_stats.tiles = 0;
+	m_stats.texelsUsed = 0;
+	for (const auto& allocation : m_allocations)
+	{
+		m_stats.tiles += static_cast<uint32_t>(allocation.second.tiles.size());
+		m_stats.texelsUsed += static_cast<uint32_t>(allocation.second.tiles.size() * allocation.second.size * allocation.second.size);
+	}
+}
+
+const std::vector<glm::ivec4>* ShadowAtlas::getTiles(uint64_t key) const
+{
+	auto it = m_allocations.find(key);
+	return it != m_allocations.end() ? &it->second.tiles : nullptr;
+}
+
+bool ShadowAtlas::wasReallocated(uint64_t key) const
+{
+	auto it = m_allocations.find(key);
+	return it == m_allocations.end() || it->second.reallocated;
+}
+
+void ShadowAtlas::beginRender() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
+	RenderStats::current().fboSwitches++;
+	glEnable(GL_SCISSOR_TEST);
+}
+
+void ShadowAtlas::beginTile(const glm::ivec4& tile) const
+{
+	glViewport(tile.x, tile.y, tile.z, tile.w);
+	glScissor(tile.x, tile.y, tile.z, tile.w);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+void ShadowAtlas::endRender() const
+{
+	glDisable(GL_SCISSOR_TEST);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	RenderStats::current().fboSwitches++;
+}
+
+void ShadowAtlas::bind(const Shader& shader, int compareUnit, int depthUnit) const
+{
+	shader.setInt("_ShadowAtlas", compareUnit);
+	shader.setInt("_ShadowAtlasDepth", depthUnit);
+	shader.setFloat("_ShadowAtlasSize", static_cast<float>(SIZE));
+	shader.setFloat("_ShadowPenumbraScale", PENUMBRA_SCALE);
+
+	glActiveTexture(GL_TEXTURE0 + compareUnit);
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+	glBindSampler(compareUnit, m_compareSampler);
+	glActiveTexture(GL_TEXTURE0 + depthUnit);
+	glBindTexture(GL_TEXTURE_2D, m_texture);
+	glBindSampler(depthUnit, m_depthSampler);
+	RenderStats::current().textureBinds += 2;
+	glActiveTexture(GL_TEXTURE0);
+}
+
+bool ShadowAtlas::allocateTile(int node, int size, glm::ivec4& tile)
+{
+	if (m_nodes[node].used || m_nodes[node].size < size)
+	{
+		return false;
+	}
+
+	if (m_nodes[node].size == size)
+	{
+		if (m_nodes[node].firstChild != -1)
+		{
+			return false;
+		}
+		m_nodes[node].used = true;
+		tile = glm::ivec4(m_nodes[node].origin, size, size);
+		return true;
+	}
+
+	if (m_nodes[node].firstChild == -1)
+	{
+		split(node);
+	}
+
+	const int firstChild = m_nodes[node].firstChild;
+	for (int child = 0; child < 4; child++)
+	{
+		if (allocateTile(firstChild + child, size, tile))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void ShadowAtlas::freeTile(int node, const glm::ivec4& tile)
+{
+	if (m_nodes[node].firstChild == -1)
+	{
+		m_nodes[node].used = false;
+		return;
+	}
+
+	const int half = m_nodes[node].size / 2;
+	const int childX = tile.x >= m_nodes[node].origin.x + half ? 1 : 0;
+	const int childY = tile.y >= m_nodes[node].origin.y + half ? 1 : 0;
+	const int firstChild = m_nodes[node].firstChild;
+	freeTile(firstChild + childY * 2 + childX, tile);
+
+	//Merge back once all four children are free leaves
+	for (int child = 0; child < 4; child++)
+	{
+		const Node& childNode = m_nodes[firstChild + child];
+		if (childNode.used || childNode.firstChild != -1)
+		{
+			return;
+		}
+	}
+	m_freeChildren.push_back(firstChild);
+	m_nodes[node].firstChild = -1;
+}
+
+void ShadowAtlas::split(int node)
+{
+	int firstChild;
+	if (!m_freeChildren.empty())
+	{
+		firstChild = m_freeChildren.back();
+		m_freeChildren.pop_back();
+	}
+	else
+	{
+		firstChild = static_cast<int>(m_nodes.size());
+		m_nodes.resize(m_nodes.size() + 4);
+	}
+
+	const int half = m_nodes[node].size / 2;
+	for (int child = 0; child < 4; child++)
+	{
+		Node& childNode = m_nodes[firstChild + child];
+		childNode.origin = m_nodes[node].origin + glm::ivec2((child & 1) * half, (child >> 1) * half);
+		childNode.size = half;
+		childNode.firstChild = -1;
+		childNode.used = false;
+	}
+	m_nodes[node].firstChild = firstChild;
+}
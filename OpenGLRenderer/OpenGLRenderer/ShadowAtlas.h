@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ShadowCache.h"
+#include "Shader.h"
+
+enum class ShadowOwner : uint64_t
+{
+	CASCADE = 1,
+	LOCAL_LIGHT = 2
+};
+
+enum class ShadowFilter
+{
+	//Rotated Poisson disk of hardware compared taps
+	PCF,
+	//Blocker search scaling the PCF kernel, contact hardening shadows
+	PCSS
+};
+
+//One depth texture shared by every shadow view, split by a quadtree into power of two tiles.
+//Views request a group of equally sized tiles each frame with a desired size and an importance.
+//Requests over the texel budget are halved least important first, then dropped. A group keeps
+//its tiles while the desired size stays within one level, so assignments (and cached shadow
+//contents) do not thrash as lights move on screen.
+class ShadowAtlas
+{
+public:
+	static constexpr int SIZE = 4096;
+	static constexpr int MIN_TILE_SIZE = 128;
+	static constexpr int MAX_KERNEL_SIZE = 32;
+	//Penumbra width in texels per unit of relative receiver to blocker depth
+	static constexpr float PENUMBRA_SCALE = 48.0f;
+
+	explicit ShadowAtlas(uint32_t texelBudget = SIZE * SIZE);
+	ShadowAtlas(const ShadowAtlas& other) = delete;
+	~ShadowAtlas();
+
+	static uint64_t makeKey(ShadowOwner owner, uint32_t index)
+	{
+		return (static_cast<uint64_t>(owner) << 56) | index;
+	}
+
+	//Defines selecting the filter permutation of the lighting shaders
+	static std::vector<std::string> getFilterDefines(ShadowFilter filter, int kernelSize);
+
+	void beginFrame();
+	//count tiles of the same size for one owner, six for a point light's cube faces
+	void request(uint64_t key, int count, int desiredSize, float importance);
+	//Fits this frame's requests into the budget and assigns tiles, keeping last frame's where possible
+	void allocate();
+
+	//Atlas pixels (x, y, size, size), nullptr when the request was dropped
+	const std::vector<glm::ivec4>* getTiles(uint64_t key) const;
+	//True when the key's tiles were assigned this frame, so previously rendered contents are gone
+	bool wasReallocated(uint64_t key) const;
+
+	//Binds the atlas framebuffer, each view then calls beginTile before drawing
+	void beginRender() const;
+	//Restricts drawing to the tile and clears its depth
+	void beginTile(const glm::ivec4& tile) const;
+	void endRender() const;
+
+	//The atlas is bound twice: hardware depth comparison on compareUnit and raw depth on
+	//depthUnit for the PCSS blocker search, each through its own sampler object
+	void bind(const Shader& shader, int compareUnit, int depthUnit) const;
+
+	[[nodiscard]] const ShadowAtlasStats& getStats() const
+	{
+		return m_stats;
+	}
+
+private:
+	struct Node
+	{
+		glm::ivec2	origin;
+		int			size;
+		//Four consecutive children, -1 for leaves
+		int			firstChild = -1;
+		bool		used = false;
+	};
+
+	struct Request
+	{
+		uint64_t	key;
+		int			count;
+		int			size;
+		float		importance;
+	};
+
+	struct Allocation
+	{
+		std::vector<glm::ivec4>	tiles;
+		int						size;
+		//Size of the request the tiles were assigned for, larger than size when the quadtree was
+		//too fragmented. Requests are compared against it so a fallback stays until the request changes
+		int						requestedSize;
+		bool					reallocated;
+	};
+
+	uint32_t									m_texelBudget;
+	unsigned int								m_texture = 0;
+	unsigned int								m_FBO = 0;
+	unsigned int								m_compareSampler = 0;
+	unsigned int								m_depthSampler = 0;
+
+	std::vector<Node>							m_nodes;
+	//First index of released groups of four children
+	std::vector<int>							m_freeChildren;
+	std::vector<Request>						m_requests;
+	std::unordered_map<uint64_t, Allocation>	m_allocations;
+
+	ShadowAtlasStats							m_stats;
+
+	bool allocateTile(int node, int size, glm::ivec4& tile);
+	void freeTile(int node, const glm::ivec4& tile);
+	void split(int node);
+};
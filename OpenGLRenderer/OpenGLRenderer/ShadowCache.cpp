@@ -0,0 +1,88 @@
+#include "ShadowCache.h"
+
+#include "Entity.h"
+
+ShadowCache::ShadowCache(int nearCount)
+	: m_nearCount(nearCount)
+{
+}
+
+void ShadowCache::beginFrame()
+{
+	m_farRefitted = false;
+	m_stats = ShadowCacheStats();
+}
+
+void ShadowCache::invalidate(int cascade)
+{
+	if (cascade < static_cast<int>(m_states.size()))
+	{
+		m_states[cascade].valid = false;
+	}
+}
+
+const ShadowCascade& ShadowCache::selectCascade(int cascade, const ShadowCascade& fitted, uint32_t lightVersion)
+{
+	if (cascade >= static_cast<int>(m_cascades.size()))
+	{
+		m_cascades.resize(cascade + 1);
+		m_states.resize(cascade + 1);
+	}
+
+	CascadeState& state = m_states[cascade];
+	const bool lightChanged = !state.valid || state.lightVersion != lightVersion;
+	const bool moved = m_cascades[cascade].worldToClip != fitted.worldToClip || m_cascades[cascade].splitDepth != fitted.splitDepth;
+
+	state.refitted = false;
+	if (lightChanged || (moved && (cascade < m_nearCount || !m_farRefitted)))
+	{
+		if (!lightChanged && cascade >= m_nearCount)
+		{
+			m_farRefitted = true;
+		}
+		state.refitted = lightChanged || moved;
+		m_cascades[cascade] = fitted;
+		state.lightVersion = lightVersion;
+	}
+
+	return m_cascades[cascade];
+}
+
+bool ShadowCache::needsRender(int cascade, const std::vector<Entity*>& casters)
+{
+	CascadeState& state = m_states[cascade];
+	const uint64_t signature = casterSignature(casters);
+
+	const bool dirty = !state.valid || state.refitted || state.casterSignature != signature;
+	state.casterSignature = signature;
+	state.valid = true;
+
+	if (dirty)
+	{
+		m_stats.rendered++;
+	}
+	else
+	{
+		m_stats.cached++;
+	}
+	return dirty;
+}
+
+uint64_t ShadowCache::casterSignature(const std::vector<Entity*>& casters)
+{
+	//FNV-1a over caster identity and transform version, order is stable for an unchanged BVH
+	uint64_t hash = 14695981039346656037ull;
+	auto mix = [&hash](uint64_t value)
+	{
+		hash ^= value;
+		hash *= 1099511628211ull;
+	};
+
+	for (const Entity* caster : casters)
+	{
+		mix(reinterpret_cast<uintptr_t>(caster));
+		mix(caster->transform.getRenderVersion());
+	}
+	mix(casters.size());
+	return hash;
+}
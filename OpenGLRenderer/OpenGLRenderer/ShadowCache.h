@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "Light.h"
+
+class Entity;
+
+struct ShadowCacheStats
+{
+	uint32_t rendered = 0;
+	uint32_t cached = 0;
+};
+
+struct ShadowAtlasStats
+{
+	uint32_t tiles = 0;
+	uint32_t texelsUsed = 0;
+	uint32_t texelBudget = 0;
+	//Groups assigned new tiles this frame
+	uint32_t reallocated = 0;
+	uint32_t dropped = 0;
+};
+
+//Tracks when a light's shadow cascades have to be re-rendered. A cascade is dirty when the light's
+//view or projection changed, when its fitted matrix moved or when the set of casters inside it or
+//any of their transforms changed. Near cascades follow the camera every frame, far cascades keep
+//sampling with the matrix they were rendered with and at most one of them is refitted per frame.
+class ShadowCache
+{
+public:
+	//Cascades below nearCount are refitted every frame
+	explicit ShadowCache(int nearCount);
+
+	void beginFrame();
+	//Forces the cascade to re-render, e.g. after it moved to another atlas tile
+	void invalidate(int cascade);
+
+	//Picks the matrix the cascade is rendered and sampled with this frame, casters are culled with it
+	const ShadowCascade& selectCascade(int cascade, const ShadowCascade& fitted, uint32_t lightVersion);
+
+	//True when the cascade's tile has to be re-rendered for these casters
+	bool needsRender(int cascade, const std::vector<Entity*>& casters);
+
+	const std::vector<ShadowCascade>& getCascades() const
+	{
+		return m_cascades;
+	}
+
+	[[nodiscard]] const ShadowCacheStats& getStats() const
+	{
+		return m_stats;
+	}
+
+	//Hash of caster identities and transform versions, changes when any caster moves, appears or leaves
+	static uint64_t casterSignature(const std::vector<Entity*>& casters);
+
+private:
+	struct CascadeState
+	{
+		uint32_t	lightVersion = 0;
+		uint64_t	casterSignature = 0;
+		bool		valid = false;
+		bool		refitted = false;
+	};
+
+	int							m_nearCount;
+	bool						m_farRefitted = false;
+	std::vector<ShadowCascade>	m_cascades;
+	std::vector<CascadeState>	m_states;
+	ShadowCacheStats			m_stats;
+};
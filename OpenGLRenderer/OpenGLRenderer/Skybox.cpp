@@ -1,15 +1,16 @@
 #include "Skybox.h"
 
+#include "RenderStats.h"
 #include "ResourceHelpers.h"
 
 Skybox::Skybox()
 {
 	m_shader = std::make_unique<Shader>("Shaders/Skybox.vs", "Shaders/Skybox.fs");
 
-	glGenVertexArrays(1, &m_VAO);
-	glGenBuffers(1, &m_VBO);
-	glBindVertexArray(m_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	m_VAO = GLVertexArray::create();
+	m_VBO = GLBuffer::create();
+	glBindVertexArray(m_VAO.get());
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBO.get());
 
 	float skyboxVertices[] = {
 		// positions          
@@ -56,6 +57,7 @@ Skybox::Skybox()
 		 1.0f, -1.0f,  1.0f
 	};
 	glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices[0], GL_STATIC_DRAW);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, m_VBO.get(), sizeof(skyboxVertices), "vec3", "Skybox");
 
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
@@ -68,16 +70,9 @@ Skybox::Skybox()
 		"resources/textures/skybox/front.jpg",
 		"resources/textures/skybox/back.jpg"
 	};
-	m_texture = loadCubemap(m_cubeFaces);
+	m_texture = GLTexture(loadCubemap(m_cubeFaces));
 }
 
-Skybox::Skybox(Skybox&& other) noexcept
-{
-	m_shader = std::move(other.m_shader);
-	m_VAO = other.m_VAO;
-	m_VBO = other.m_VBO;
-	m_texture = other.m_texture;
-}
 
 void Skybox::Draw(const glm::mat4& proj, const glm::mat4& view)
 {
@@ -86,8 +81,16 @@ void Skybox::Draw(const glm::mat4& proj, const glm::mat4& view)
 	m_shader->setMat4("projection", proj);
 	m_shader->setMat4("view", view); 
 
-	glBindVertexArray(m_VAO); 
-	glBindTexture(GL_TEXTURE_CUBE_MAP, m_texture); 
-	glDrawArrays(GL_TRIANGLES, 0, 36); 
+	glBindTexture(GL_TEXTURE_CUBE_MAP, m_texture.get()); 
+	DrawCube();
+	RenderStats::current().textureBinds++;
+	RenderStats::current().addDraw(36);
 	glDepthMask(GL_TRUE); 
 }
+
+void Skybox::DrawCube() const
+{
+	glBindVertexArray(m_VAO.get());
+	glDrawArrays(GL_TRIANGLES, 0, 36);
+	glBindVertexArray(0);
+}
@@ -3,6 +3,7 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include "GLResource.h"
 #include "Shader.h"
 
 //TODO Reconsider later
@@ -11,17 +12,29 @@ class Skybox
 public:
 	Skybox();
 	Skybox(Skybox& other) = delete;
-	Skybox(Skybox&& other) noexcept;
+	Skybox(Skybox&& other) noexcept = default;
 
 	~Skybox() = default;
 
 	void Draw(const glm::mat4& proj, const glm::mat4& view);
+	//Draws the unit cube with whatever shader is currently bound
+	void DrawCube() const;
+
+	[[nodiscard]] uint32_t getTexture() const
+	{
+		return m_texture.get();
+	}
+
+	[[nodiscard]] const std::vector<std::string>& getCubeFaces() const
+	{
+		return m_cubeFaces;
+	}
 
 private:
 	std::unique_ptr<Shader>		m_shader;
-	uint32_t					m_VAO;
-	uint32_t					m_VBO;
-	uint32_t					m_texture;
+	GLVertexArray				m_VAO;
+	GLBuffer					m_VBO;
+	GLTexture					m_texture;
 
 	std::vector<std::string>	m_cubeFaces;
 };
@@ -0,0 +1,365 @@
+#include "SoftwareOcclusion.h"
+
+#include <chrono>
+#include <cmath>
+
+#include <immintrin.h>
+
+#include "CpuProfiler.h"
+
+namespace
+{
+	//Keeps vertices off the w = 0 singularity after near plane clipping
+	constexpr float MIN_W = 1e-5f;
+
+#if defined(__AVX__)
+	constexpr int LANES = 8;
+#else
+	constexpr int LANES = 4;
+#endif
+}
+
+SoftwareOcclusion::SoftwareOcclusion()
+	: m_depth(WIDTH * HEIGHT, 1.0f)
+{
+}
+
+SoftwareOcclusion::~SoftwareOcclusion()
+{
+	wait();
+}
+
+uint32_t SoftwareOcclusion::addOccluder(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const glm::mat4& model)
+{
+	wait();
+	m_occluders.push_back({ positions, indices, model });
+	return static_cast<uint32_t>(m_occluders.size() - 1);
+}
+
+void SoftwareOcclusion::setOccluderTransform(uint32_t occluder, const glm::mat4& model)
+{
+	wait();
+	m_occluders[occluder].model = model;
+}
+
+void SoftwareOcclusion::beginFrame(const glm::mat4& worldToClip)
+{
+	wait();
+	m_worldToClip = worldToClip;
+	JobSystem::get().run("SoftwareOcclusion::render", [this]() { render(); }, &m_frame);
+}
+
+void SoftwareOcclusion::wait()
+{
+	PROFILE_SCOPE("SoftwareOcclusion::wait");
+	JobSystem::get().wait(m_frame);
+}
+
+bool SoftwareOcclusion::isVisible(const AABB& bounds) const
+{
+	glm::vec2 screenMin(FLT_MAX);
+	glm::vec2 screenMax(-FLT_MAX);
+	float minDepth = 1.0f;
+	for (int i = 0; i < 8; i++)
+	{
+		const glm::vec3 corner((i & 1) ? bounds.max.x : bounds.min.x,
+							   (i & 2) ? bounds.max.y : bounds.min.y,
+							   (i & 4) ? bounds.max.z : bounds.min.z);
+		const glm::vec4 clip = m_worldToClip * glm::vec4(corner, 1.0f);
+
+		//Crossing the near plane, keep it
+		if (clip.w <= MIN_W || clip.z < -clip.w)
+		{
+			return true;
+		}
+
+		const glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		const glm::vec2 screen = (glm::vec2(ndc) * 0.5f + 0.5f) * glm::vec2(WIDTH, HEIGHT);
+		screenMin = glm::min(screenMin, screen);
+		screenMax = glm::max(screenMax, screen);
+		minDepth = std::min(minDepth, ndc.z * 0.5f + 0.5f);
+	}
+
+	//Off screen boxes are left to frustum culling
+	if (screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x > WIDTH || screenMin.y > HEIGHT)
+	{
+		return true;
+	}
+
+	const int x0 = std::clamp(static_cast<int>(screenMin.x), 0, WIDTH - 1);
+	const int y0 = std::clamp(static_cast<int>(screenMin.y), 0, HEIGHT - 1);
+	const int x1 = std::clamp(static_cast<int>(screenMax.x), 0, WIDTH - 1);
+	const int y1 = std::clamp(static_cast<int>(screenMax.y), 0, HEIGHT - 1);
+	const int xStart = x0 - x0 % LANES;
+
+	//Visible as soon as one covered pixel is not nearer than the box
+#if defined(__AVX__)
+	const __m256 laneIndex = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	const __m256 first = _mm256_set1_ps(static_cast<float>(x0));
+	const __m256 last = _mm256_set1_ps(static_cast<float>(x1));
+	const __m256 boxDepth = _mm256_set1_ps(minDepth);
+	for (int y = y0; y <= y1; y++)
+	{
+		const float* row = m_depth.data() + y * WIDTH;
+		for (int x = xStart; x <= x1; x += LANES)
+		{
+			const __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneIndex);
+			const __m256 inside = _mm256_and_ps(_mm256_cmp_ps(px, first, _CMP_GE_OQ), _mm256_cmp_ps(px, last, _CMP_LE_OQ));
+			const __m256 farther = _mm256_cmp_ps(_mm256_loadu_ps(row + x), boxDepth, _CMP_GE_OQ);
+			if (_mm256_movemask_ps(_mm256_and_ps(inside, farther)) != 0)
+			{
+				return true;
+			}
+		}
+	}
+#else
+	const __m128 laneIndex = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	const __m128 first = _mm_set1_ps(static_cast<float>(x0));
+	const __m128 last = _mm_set1_ps(static_cast<float>(x1));
+	const __m128 boxDepth = _mm_set1_ps(minDepth);
+	for (int y = y0; y <= y1; y++)
+	{
+		const float* row = m_depth.data() + y * WIDTH;
+		for (int x = xStart; x <= x1; x += LANES)
+		{
+			const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneIndex);
+			const __m128 inside = _mm_and_ps(_mm_cmpge_ps(px, first), _mm_cmple_ps(px, last));
+			const __m128 farther = _mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth);
+			if (_mm_movemask_ps(_mm_and_ps(inside, farther)) != 0)
+			{
+				return true;
+			}
+		}
+	}
+#endif
+
+	return false;
+}
+
+void SoftwareOcclusion::render()
+{
+	PROFILE_SCOPE("SoftwareOcclusion::render");
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+	setupTriangles();
+
+	//Tiles own disjoint parts of the depth buffer, one job each
+	JobSystem::get().parallelFor("SoftwareOcclusion::rasterize", TILES_X * TILES_Y, 1, [this](size_t begin, size_t end)
+	{
+		for (size_t tile = begin; tile < end; tile++)
+		{
+			rasterizeTile(static_cast<int>(tile));
+		}
+	});
+
+	const auto end = std::chrono::high_resolution_clock::now();
+	m_stats.buildMs = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void SoftwareOcclusion::setupTriangles()
+{
+	m_triangles.clear();
+	for (auto& bin : m_bins)
+	{
+		bin.clear();
+	}
+
+	std::vector<glm::vec4> clipPositions;
+	for (const Occluder& occluder : m_occluders)
+	{
+		const glm::mat4 modelToClip = m_worldToClip * occluder.model;
+		clipPositions.resize(occluder.positions.size());
+		for (size_t i = 0; i < occluder.positions.size(); i++)
+		{
+			clipPositions[i] = modelToClip * glm::vec4(occluder.positions[i], 1.0f);
+		}
+
+		for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3)
+		{
+			clipAndBin(clipPositions[occluder.indices[i]], clipPositions[occluder.indices[i + 1]], clipPositions[occluder.indices[i + 2]]);
+		}
+	}
+}
+
+void SoftwareOcclusion::clipAndBin(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2)
+{
+	//Near plane is z = -w, the other planes are handled by the screen bounds
+	const glm::vec4 input[3] = { c0, c1, c2 };
+	const float dist[3] = { c0.z + c0.w, c1.z + c1.w, c2.z + c2.w };
+	if (dist[0] >= 0.0f && dist[1] >= 0.0f && dist[2] >= 0.0f)
+	{
+		addScreenTriangle(c0, c1, c2);
+		return;
+	}
+
+	glm::vec4 polygon[4];
+	int count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const int next = (i + 1) % 3;
+		if (dist[i] >= 0.0f)
+		{
+			polygon[count++] = input[i];
+		}
+		if ((dist[i] >= 0.0f) != (dist[next] >= 0.0f))
+		{
+			const float t = dist[i] / (dist[i] - dist[next]);
+			polygon[count++] = glm::mix(input[i], input[next], t);
+		}
+	}
+
+	for (int i = 1; i + 1 < count; i++)
+	{
+		addScreenTriangle(polygon[0], polygon[i], polygon[i + 1]);
+	}
+}
+
+void SoftwareOcclusion::addScreenTriangle(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2)
+{
+	const glm::vec4 clip[3] = { c0, c1, c2 };
+	glm::vec3 screen[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const float invW = 1.0f / std::max(clip[i].w, MIN_W);
+		screen[i] = glm::vec3((clip[i].x * invW * 0.5f + 0.5f) * WIDTH,
+							  (clip[i].y * invW * 0.5f + 0.5f) * HEIGHT,
+							  clip[i].z * invW * 0.5f + 0.5f);
+	}
+
+	const float minX = std::min({ screen[0].x, screen[1].x, screen[2].x });
+	const float maxX = std::max({ screen[0].x, screen[1].x, screen[2].x });
+	const float minY = std::min({ screen[0].y, screen[1].y, screen[2].y });
+	const float maxY = std::max({ screen[0].y, screen[1].y, screen[2].y });
+	if (maxX < 0.0f || maxY < 0.0f || minX >= WIDTH || minY >= HEIGHT)
+	{
+		return;
+	}
+
+	const uint32_t index = static_cast<uint32_t>(m_triangles.size());
+	m_triangles.push_back({ screen[0], screen[1], screen[2] });
+
+	const int tileX0 = std::max(0, static_cast<int>(minX) / TILE_WIDTH);
+	const int tileY0 = std::max(0, static_cast<int>(minY) / TILE_HEIGHT);
+	const int tileX1 = std::min(TILES_X - 1, static_cast<int>(maxX) / TILE_WIDTH);
+	const int tileY1 = std::min(TILES_Y - 1, static_cast<int>(maxY) / TILE_HEIGHT);
+	for (int ty = tileY0; ty <= tileY1; ty++)
+	{
+		for (int tx = tileX0; tx <= tileX1; tx++)
+		{
+			m_bins[ty * TILES_X + tx].push_back(index);
+		}
+	}
+}
+
+void SoftwareOcclusion::rasterizeTile(int tile)
+{
+	const int tileX0 = (tile % TILES_X) * TILE_WIDTH;
+	const int tileY0 = (tile / TILES_X) * TILE_HEIGHT;
+	const int tileX1 = tileX0 + TILE_WIDTH - 1;
+	const int tileY1 = tileY0 + TILE_HEIGHT - 1;
+
+	for (uint32_t index : m_bins[tile])
+	{
+		const ScreenTriangle& tri = m_triangles[index];
+		glm::vec3 v0 = tri.v0;
+		glm::vec3 v1 = tri.v1;
+		glm::vec3 v2 = tri.v2;
+
+		//Occluders are treated as two sided, flip to counter clockwise
+		float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+		if (area < 0.0f)
+		{
+			std::swap(v1, v2);
+			area = -area;
+		}
+		if (area < 1e-6f)
+		{
+			continue;
+		}
+
+		//Edge functions, each one is the weight of the opposite vertex scaled by the area
+		const float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v1.y * v2.x;
+		const float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v2.y * v0.x;
+		const float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v0.y * v1.x;
+
+		//Window depth is affine in screen space
+		const float invArea = 1.0f / area;
+		const float za = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * invArea;
+		const float zb = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * invArea;
+		const float zc = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * invArea;
+
+		const int minX = std::max(tileX0, static_cast<int>(std::floor(std::min({ v0.x, v1.x, v2.x }))));
+		const int maxX = std::min(tileX1, static_cast<int>(std::ceil(std::max({ v0.x, v1.x, v2.x }))));
+		const int minY = std::max(tileY0, static_cast<int>(std::floor(std::min({ v0.y, v1.y, v2.y }))));
+		const int maxY = std::min(tileY1, static_cast<int>(std::ceil(std::max({ v0.y, v1.y, v2.y }))));
+		if (minX > maxX || minY > maxY)
+		{
+			continue;
+		}
+		const int xStart = minX - (minX - tileX0) % LANES;
+
+#if defined(__AVX__)
+		const __m256 laneCenter = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+		const __m256 zero = _mm256_setzero_ps();
+		for (int y = minY; y <= maxY; y++)
+		{
+			const float py = y + 0.5f;
+			const __m256 row0 = _mm256_set1_ps(b0 * py + c0);
+			const __m256 row1 = _mm256_set1_ps(b1 * py + c1);
+			const __m256 row2 = _mm256_set1_ps(b2 * py + c2);
+			const __m256 rowZ = _mm256_set1_ps(zb * py + zc);
+			float* row = m_depth.data() + y * WIDTH;
+
+			for (int x = xStart; x <= maxX; x += LANES)
+			{
+				const __m256 px = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(x)), laneCenter);
+				const __m256 e0 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a0), px), row0);
+				const __m256 e1 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a1), px), row1);
+				const __m256 e2 = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(a2), px), row2);
+				const __m256 covered = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(e0, zero, _CMP_GE_OQ), _mm256_cmp_ps(e1, zero, _CMP_GE_OQ)),
+					_mm256_cmp_ps(e2, zero, _CMP_GE_OQ));
+				if (_mm256_movemask_ps(covered) == 0)
+				{
+					continue;
+				}
+
+				const __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(za), px), rowZ);
+				const __m256 depth = _mm256_loadu_ps(row + x);
+				_mm256_storeu_ps(row + x, _mm256_blendv_ps(depth, _mm256_min_ps(depth, z), covered));
+			}
+		}
+#else
+		const __m128 laneCenter = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+		const __m128 zero = _mm_setzero_ps();
+		for (int y = minY; y <= maxY; y++)
+		{
+			const float py = y + 0.5f;
+			const __m128 row0 = _mm_set1_ps(b0 * py + c0);
+			const __m128 row1 = _mm_set1_ps(b1 * py + c1);
+			const __m128 row2 = _mm_set1_ps(b2 * py + c2);
+			const __m128 rowZ = _mm_set1_ps(zb * py + zc);
+			float* row = m_depth.data() + y * WIDTH;
+
+			for (int x = xStart; x <= maxX; x += LANES)
+			{
+				const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneCenter);
+				const __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), row0);
+				const __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), row1);
+				const __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), row2);
+				const __m128 covered = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+				if (_mm_movemask_ps(covered) == 0)
+				{
+					continue;
+				}
+
+				//SSE2 has no blend, select with masks
+				const __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), rowZ);
+				const __m128 depth = _mm_loadu_ps(row + x);
+				const __m128 nearest = _mm_min_ps(depth, z);
+				_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(covered, nearest), _mm_andnot_ps(covered, depth)));
+			}
+		}
+#endif
+	}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include <glm.hpp>
+
+#include "Bounds.h"
+#include "Frustum.h"
+#include "JobSystem.h"
+
+//Depth-only software rasterizer for coarse occlusion culling before any GL submission.
+//Occluder triangles are transformed and binned in a job, then tiles are rasterized as parallel
+//jobs with SSE/AVX, 4 or 8 pixels per step. Boxes are occluded when every covered pixel is
+//nearer than the box's nearest point. Has no GL dependency so it can run on a headless machine.
+class SoftwareOcclusion
+{
+public:
+	static constexpr int WIDTH = 256;
+	static constexpr int HEIGHT = 128;
+	static constexpr int TILE_WIDTH = 64;
+	static constexpr int TILE_HEIGHT = 32;
+	static constexpr int TILES_X = WIDTH / TILE_WIDTH;
+	static constexpr int TILES_Y = HEIGHT / TILE_HEIGHT;
+
+	SoftwareOcclusion();
+	SoftwareOcclusion(const SoftwareOcclusion& other) = delete;
+	~SoftwareOcclusion();
+
+	//Returns the occluder id. Positions are in local space, indices form a triangle list.
+	uint32_t addOccluder(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices, const glm::mat4& model);
+	void setOccluderTransform(uint32_t occluder, const glm::mat4& model);
+
+	//Starts rasterizing all occluders on the job system, occluders must not change until wait()
+	void beginFrame(const glm::mat4& worldToClip);
+	void wait();
+
+	//Only valid after wait()
+	bool isVisible(const AABB& bounds) const;
+
+	//Removes occluded items in place, T must provide getWorldBounds()
+	template<typename T>
+	void cull(std::vector<T*>& items)
+	{
+		wait();
+		m_stats.tested = static_cast<uint32_t>(items.size());
+		auto occluded = std::remove_if(items.begin(), items.end(), [this](const T* item)
+		{
+			return !isVisible(item->getWorldBounds());
+		});
+		m_stats.culled = static_cast<uint32_t>(std::distance(occluded, items.end()));
+		items.erase(occluded, items.end());
+	}
+
+	[[nodiscard]] const float* getDepth() const
+	{
+		return m_depth.data();
+	}
+
+	[[nodiscard]] const OcclusionStats& getStats() const
+	{
+		return m_stats;
+	}
+
+private:
+	struct Occluder
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<uint32_t> indices;
+		glm::mat4 model;
+	};
+
+	//Window space vertices, z in [0, 1]
+	struct ScreenTriangle
+	{
+		glm::vec3 v0;
+		glm::vec3 v1;
+		glm::vec3 v2;
+	};
+
+	std::vector<Occluder>			m_occluders;
+	glm::mat4						m_worldToClip = glm::mat4(1.0f);
+
+	std::vector<ScreenTriangle>		m_triangles;
+	std::vector<uint32_t>			m_bins[TILES_X * TILES_Y];
+	std::vector<float>				m_depth;
+
+	JobCounter						m_frame;
+	OcclusionStats					m_stats;
+
+	void render();
+	void setupTriangles();
+	void clipAndBin(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2);
+	void addScreenTriangle(const glm::vec4& c0, const glm::vec4& c1, const glm::vec4& c2);
+	void rasterizeTile(int tile);
+};
@@ -0,0 +1,288 @@
+#include "StaticGeometry.h"
+
+#include <algorithm>
+
+#include "CpuProfiler.h"
+#include "GpuMemoryTracker.h"
+#include "RenderStats.h"
+
+StaticGeometry::~StaticGeometry()
+{
+	glDeleteVertexArrays(1, &m_VAO);
+	glDeleteBuffers(1, &m_VBO);
+	glDeleteBuffers(1, &m_EBO);
+	glDeleteBuffers(1, &m_drawIdVBO);
+	glDeleteBuffers(1, &m_drawDataSSBO);
+	glDeleteBuffers(1, &m_commandBuffer);
+
+	GpuMemoryTracker& tracker = GpuMemoryTracker::get();
+	tracker.release(GpuResourceKind::BUFFER, m_VBO);
+	tracker.release(GpuResourceKind::BUFFER, m_EBO);
+	tracker.release(GpuResourceKind::BUFFER, m_drawIdVBO);
+	tracker.release(GpuResourceKind::BUFFER, m_drawDataSSBO);
+	tracker.release(GpuResourceKind::BUFFER, m_commandBuffer);
+}
+
+void StaticGeometry::add(Entity* entity)
+{
+	m_entities.push_back(entity);
+}
+
+void StaticGeometry::build()
+{
+	std::vector<Vertex> vertices;
+	std::vector<unsigned int> indices;
+
+	for (Entity* entity : m_entities)
+	{
+		EntityDraws& draws = m_entityDraws[entity];
+		draws.version = entity->transform.getRenderVersion();
+
+		for (const auto& mesh : entity->getMeshes())
+		{
+			DrawRecord record;
+			record.indexCount = static_cast<GLuint>(mesh.getIndices().size());
+			record.firstIndex = static_cast<GLuint>(indices.size());
+			record.baseVertex = static_cast<GLint>(vertices.size());
+			record.material = findOrAddMaterial(mesh);
+			record.localBounds = mesh.getBounds();
+
+			vertices.insert(vertices.end(), mesh.getVertices().begin(), mesh.getVertices().end());
+			indices.insert(indices.end(), mesh.getIndices().begin(), mesh.getIndices().end());
+
+			draws.records.push_back(static_cast<uint32_t>(m_records.size()));
+			m_records.push_back(record);
+			const AABB worldBounds = record.localBounds.transformed(entity->transform.getRenderMatrix());
+			m_drawData.push_back({ entity->transform.getRenderMatrix(), glm::uvec4(record.material, 0, 0, 0),
+				glm::vec4(worldBounds.min, 1.0f), glm::vec4(worldBounds.max, 1.0f) });
+		}
+	}
+
+	m_materialBuckets.resize(std::max<size_t>(m_materials.size(), 1));
+
+	//Draw index i is read by instance i of the draw id attribute
+	std::vector<GLuint> drawIds(m_records.size());
+	for (size_t i = 0; i < drawIds.size(); i++)
+	{
+		drawIds[i] = static_cast<GLuint>(i);
+	}
+
+	glGenVertexArrays(1, &m_VAO);
+	glGenBuffers(1, &m_VBO);
+	glGenBuffers(1, &m_EBO);
+	glGenBuffers(1, &m_drawIdVBO);
+
+	glBindVertexArray(m_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+
+	//vertex positions
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+	//normals
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+	//tex coords
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoord));
+	//draw id
+	glBindBuffer(GL_ARRAY_BUFFER, m_drawIdVBO);
+	glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLuint), drawIds.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(3);
+	glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+	glVertexAttribDivisor(3, 1);
+
+	glBindVertexArray(0);
+
+	glGenBuffers(1, &m_drawDataSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, m_drawData.size() * sizeof(DrawData), m_drawData.data(), GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glGenBuffers(1, &m_commandBuffer);
+
+	GpuMemoryTracker& tracker = GpuMemoryTracker::get();
+	tracker.allocate(GpuResourceKind::BUFFER, m_VBO, vertices.size() * sizeof(Vertex), "Vertex", "StaticGeometry");
+	tracker.allocate(GpuResourceKind::BUFFER, m_EBO, indices.size() * sizeof(unsigned int), "uint32 index", "StaticGeometry");
+	tracker.allocate(GpuResourceKind::BUFFER, m_drawIdVBO, drawIds.size() * sizeof(GLuint), "uint32", "StaticGeometry");
+	tracker.allocate(GpuResourceKind::BUFFER, m_drawDataSSBO, m_drawData.size() * sizeof(DrawData), "DrawData", "StaticGeometry");
+}
+
+void StaticGeometry::updateTransforms()
+{
+	PROFILE_SCOPE("StaticGeometry::updateTransforms");
+
+	//Changed records are patched in the CPU copy, the dirty range is then uploaded in one call
+	uint32_t dirtyBegin = static_cast<uint32_t>(m_drawData.size());
+	uint32_t dirtyEnd = 0;
+	for (Entity* entity : m_entities)
+	{
+		EntityDraws& draws = m_entityDraws[entity];
+		const uint32_t version = entity->transform.getRenderVersion();
+		if (version == draws.version)
+		{
+			continue;
+		}
+
+		draws.version = version;
+		const glm::mat4& model = entity->transform.getRenderMatrix();
+		for (uint32_t record : draws.records)
+		{
+			DrawData& data = m_drawData[record];
+			const AABB worldBounds = m_records[record].localBounds.transformed(model);
+			data.model = model;
+			data.boundsMin = glm::vec4(worldBounds.min, 1.0f);
+			data.boundsMax = glm::vec4(worldBounds.max, 1.0f);
+			dirtyBegin = std::min(dirtyBegin, record);
+			dirtyEnd = std::max(dirtyEnd, record + 1);
+		}
+	}
+
+	if (dirtyBegin >= dirtyEnd)
+	{
+		return;
+	}
+
+	const size_t bytes = (dirtyEnd - dirtyBegin) * sizeof(DrawData);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_drawDataSSBO);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, dirtyBegin * sizeof(DrawData), bytes, &m_drawData[dirtyBegin]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	RenderStats::current().bytesUploaded += bytes;
+}
+
+void StaticGeometry::Draw(const std::vector<Entity*>& visible, Shader& shader, bool bindMaterials)
+{
+	prepare(visible, bindMaterials);
+	submit(shader, bindMaterials);
+}
+
+void StaticGeometry::prepare(const std::vector<Entity*>& visible, bool bindMaterials)
+{
+	PROFILE_SCOPE("StaticGeometry::prepare");
+	//Bucket visible draws by material, the depth pass only needs one bucket
+	for (auto& bucket : m_materialBuckets)
+	{
+		bucket.clear();
+	}
+
+	for (Entity* entity : visible)
+	{
+		auto it = m_entityDraws.find(entity);
+		if (it == m_entityDraws.end())
+		{
+			continue;
+		}
+
+		for (uint32_t record : it->second.records)
+		{
+			m_materialBuckets[bindMaterials ? m_records[record].material : 0].push_back(record);
+		}
+	}
+
+	m_commands.clear();
+	for (const auto& bucket : m_materialBuckets)
+	{
+		for (uint32_t record : bucket)
+		{
+			const DrawRecord& draw = m_records[record];
+			m_commands.push_back({ draw.indexCount, 1, draw.firstIndex, draw.baseVertex, record });
+		}
+	}
+
+	if (m_commands.empty())
+	{
+		return;
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	//Orphan so the previous pass's commands can still be in flight
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commands.size() * sizeof(DrawElementsIndirectCommand), m_commands.data(), GL_STREAM_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	RenderStats::current().bytesUploaded += m_commands.size() * sizeof(DrawElementsIndirectCommand);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, m_commandBuffer,
+		m_commands.size() * sizeof(DrawElementsIndirectCommand), "DrawElementsIndirectCommand", "StaticGeometry");
+}
+
+void StaticGeometry::submit(Shader& shader, bool bindMaterials)
+{
+	PROFILE_SCOPE("StaticGeometry::submit");
+	if (m_commands.empty())
+	{
+		return;
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_drawDataSSBO);
+	glBindVertexArray(m_VAO);
+
+	if (bindMaterials)
+	{
+		shader.setInt("_Material.texture_diffuse1", 0);
+		shader.setInt("_Material.texture_specular1", 1);
+	}
+
+	size_t first = 0;
+	for (size_t material = 0; material < m_materialBuckets.size(); material++)
+	{
+		const size_t count = m_materialBuckets[material].size();
+		if (count == 0)
+		{
+			continue;
+		}
+
+		if (bindMaterials)
+		{
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, m_materials[material].diffuse);
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, m_materials[material].specular);
+			RenderStats::current().textureBinds += 2;
+		}
+
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+			(void*)(first * sizeof(DrawElementsIndirectCommand)), static_cast<GLsizei>(count), 0);
+		RenderStats& stats = RenderStats::current();
+		stats.drawCalls++;
+		for (size_t i = first; i < first + count; i++)
+		{
+			stats.vertices += static_cast<uint64_t>(m_commands[i].count) * m_commands[i].instanceCount;
+			stats.triangles += static_cast<uint64_t>(m_commands[i].count / 3) * m_commands[i].instanceCount;
+		}
+		first += count;
+	}
+
+	//Setting up default value
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+uint32_t StaticGeometry::findOrAddMaterial(const Mesh& mesh)
+{
+	Material material{ 0, 0 };
+	for (const auto& texture : mesh.getTextures())
+	{
+		if (texture.type == "texture_diffuse" && material.diffuse == 0)
+		{
+			material.diffuse = texture.id;
+		}
+		else if (texture.type == "texture_specular" && material.specular == 0)
+		{
+			material.specular = texture.id;
+		}
+	}
+
+	for (size_t i = 0; i < m_materials.size(); i++)
+	{
+		if (m_materials[i].diffuse == material.diffuse && m_materials[i].specular == material.specular)
+		{
+			return static_cast<uint32_t>(i);
+		}
+	}
+
+	m_materials.push_back(material);
+	return static_cast<uint32_t>(m_materials.size() - 1);
+}
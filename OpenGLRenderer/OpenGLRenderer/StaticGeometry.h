@@ -0,0 +1,107 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "Entity.h"
+#include "GLExtensions.h"
+#include "Shader.h"
+
+//Static meshes packed into shared vertex/index buffers and submitted with glMultiDrawElementsIndirect.
+//Per-draw data (model matrix, material index) lives in an SSBO. GL 4.3 has no gl_DrawID, so the draw
+//index is fed through baseInstance and an instanced integer attribute at location 3.
+//Draws are grouped by material so the main pass needs one multi-draw per distinct texture set
+//and the depth pass exactly one. Requires GL 4.3.
+class StaticGeometry
+{
+public:
+	StaticGeometry() = default;
+	StaticGeometry(const StaticGeometry& other) = delete;
+	~StaticGeometry();
+
+	//Entities must be added before build()
+	void add(Entity* entity);
+	void build();
+
+	//Re-uploads model matrices and bounds of entities whose transform changed
+	void updateTransforms();
+
+	//Builds commands for the visible entities and submits them.
+	//Entities that were never added are ignored.
+	void Draw(const std::vector<Entity*>& visible, Shader& shader, bool bindMaterials);
+
+	//Draw split in two so the uploaded commands can be culled on the GPU in between
+	void prepare(const std::vector<Entity*>& visible, bool bindMaterials);
+	void submit(Shader& shader, bool bindMaterials);
+
+	[[nodiscard]] bool contains(const Entity* entity) const
+	{
+		return m_entityDraws.count(entity) != 0;
+	}
+
+	[[nodiscard]] unsigned int getCommandBuffer() const
+	{
+		return m_commandBuffer;
+	}
+
+	[[nodiscard]] unsigned int getCommandCount() const
+	{
+		return static_cast<unsigned int>(m_commands.size());
+	}
+
+	[[nodiscard]] unsigned int getDrawDataBuffer() const
+	{
+		return m_drawDataSSBO;
+	}
+
+private:
+	struct DrawRecord
+	{
+		GLuint indexCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		uint32_t material;
+		AABB localBounds;
+	};
+
+	struct Material
+	{
+		unsigned int diffuse;
+		unsigned int specular;
+	};
+
+	//Matches the std430 DrawData struct in the MDI vertex shaders
+	struct DrawData
+	{
+		glm::mat4 model;
+		glm::uvec4 material;
+		//World space bounds, read by the occlusion culling pass
+		glm::vec4 boundsMin;
+		glm::vec4 boundsMax;
+	};
+
+	struct EntityDraws
+	{
+		std::vector<uint32_t> records;
+		uint32_t version;
+	};
+
+	std::vector<Entity*>							m_entities;
+	std::unordered_map<const Entity*, EntityDraws>	m_entityDraws;
+	std::vector<DrawRecord>							m_records;
+	std::vector<Material>							m_materials;
+	std::vector<DrawData>							m_drawData;
+
+	//Per-frame command build
+	std::vector<std::vector<uint32_t>>				m_materialBuckets;
+	std::vector<DrawElementsIndirectCommand>		m_commands;
+
+	unsigned int m_VAO = 0;
+	unsigned int m_VBO = 0;
+	unsigned int m_EBO = 0;
+	unsigned int m_drawIdVBO = 0;
+	unsigned int m_drawDataSSBO = 0;
+	unsigned int m_commandBuffer = 0;
+
+	uint32_t findOrAddMaterial(const Mesh& mesh);
+};
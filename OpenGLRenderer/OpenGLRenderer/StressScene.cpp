@@ -0,0 +1,178 @@
+#include "StressScene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <gtc/matrix_transform.hpp>
+
+#include "GpuMemoryTracker.h"
+#include "JobSystem.h"
+
+namespace
+{
+	constexpr int TEXTURE_SIZE = 64;
+	//Distance between chain roots
+	constexpr float SPACING = 2.5f;
+
+	std::vector<Mesh> createCube(unsigned int texture)
+	{
+		const glm::vec3 normals[6] = {
+			glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f),
+			glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f),
+			glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f)
+		};
+
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		for (const glm::vec3& normal : normals)
+		{
+			const glm::vec3 up = std::abs(normal.y) > 0.5f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			const glm::vec3 right = glm::cross(up, normal);
+			const unsigned int first = static_cast<unsigned int>(vertices.size());
+			for (int corner = 0; corner < 4; corner++)
+			{
+				const glm::vec2 uv((corner & 1) ? 1.0f : 0.0f, (corner & 2) ? 1.0f : 0.0f);
+				const glm::vec3 position = 0.5f * (normal + (uv.x * 2.0f - 1.0f) * right + (uv.y * 2.0f - 1.0f) * up);
+				vertices.push_back({ position, normal, uv });
+			}
+			indices.insert(indices.end(), { first, first + 1, first + 3, first, first + 3, first + 2 });
+		}
+
+		std::vector<Texture> textures;
+		textures.push_back({ texture, "texture_diffuse", "" });
+
+		std::vector<Mesh> meshes;
+		meshes.emplace_back(vertices, indices, textures);
+		return meshes;
+	}
+}
+
+StressScene::StressScene(const StressSceneSettings& settings, Model& propModel)
+	: m_settings(settings)
+{
+	m_settings.hierarchyDepth = std::max(1, m_settings.hierarchyDepth);
+	m_settings.textures = std::max(1, m_settings.textures);
+	createTextures();
+
+	std::mt19937 random(m_settings.seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	//Roots on a square grid, props and lights spread over the same area
+	const int rootCount = (m_settings.entities + m_settings.hierarchyDepth - 1) / m_settings.hierarchyDepth;
+	const int gridSize = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<float>(rootCount)))));
+	const float halfExtent = 0.5f * SPACING * static_cast<float>(gridSize);
+
+	int created = 0;
+	for (int root = 0; root < rootCount; root++)
+	{
+		m_ownedRoots.push_back(std::make_unique<Entity>(createCube(m_textures[created % m_textures.size()])));
+		Entity* entity = m_ownedRoots.back().get();
+		entity->transform.setLocalPos(glm::vec3(
+			static_cast<float>(root % gridSize) * SPACING - halfExtent, 0.5f,
+			static_cast<float>(root / gridSize) * SPACING - halfExtent));
+		entity->transform.setLocalRotation(glm::vec3(0.0f, unit(random) * 360.0f, 0.0f));
+		m_roots.push_back(entity);
+		m_entities.push_back(entity);
+		created++;
+
+		//Each child sits on top of its parent, smaller and offset so rotation moves it
+		for (int level = 1; level < m_settings.hierarchyDepth && created < m_settings.entities; level++)
+		{
+			entity->addChild(createCube(m_textures[created % m_textures.size()]));
+			Entity* child = entity->getChild(0).get();
+			child->transform.setLocalPos(glm::vec3(0.3f, 1.0f, 0.0f));
+			child->transform.setLocalRotation(glm::vec3(0.0f, 30.0f, 0.0f));
+			child->transform.setLocalScale(glm::vec3(0.8f));
+			m_entities.push_back(child);
+			entity = child;
+			created++;
+		}
+	}
+	update(0.0f);
+
+	m_props = std::make_unique<InstanceBatch>(propModel);
+	Transform propTransform;
+	for (int i = 0; i < m_settings.props; i++)
+	{
+		propTransform.setLocalPos(glm::vec3((unit(random) * 2.0f - 1.0f) * halfExtent, 0.0f, (unit(random) * 2.0f - 1.0f) * halfExtent));
+		propTransform.setLocalRotation(glm::vec3(0.0f, unit(random) * 360.0f, 0.0f));
+		propTransform.computeModelMatrix();
+		m_props->add(propTransform.getModelMatrix());
+	}
+	m_props->upload();
+
+	for (int i = 0; i < m_settings.lights; i++)
+	{
+		LocalLight light;
+		light.position = glm::vec3((unit(random) * 2.0f - 1.0f) * halfExtent, 1.0f + unit(random) * 2.0f, (unit(random) * 2.0f - 1.0f) * halfExtent);
+		light.diffuse = glm::vec3(unit(random), unit(random), unit(random));
+		light.specular = light.diffuse;
+		light.intensity = 1.0f;
+		m_lights.push_back(light);
+	}
+}
+
+StressScene::~StressScene()
+{
+	glDeleteTextures(static_cast<GLsizei>(m_textures.size()), m_textures.data());
+	GpuMemoryTracker::get().release(GpuResourceKind::TEXTURE, m_textures.data(), static_cast<int>(m_textures.size()));
+}
+
+void StressScene::update(float time)
+{
+	//Chains share no transforms, so each job updates whole hierarchies
+	JobSystem::get().parallelFor("StressScene::update", m_roots.size(), 64, [this, time](size_t begin, size_t end)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			//Roots spin at slightly different rates so their chains never line up
+			const float speed = 20.0f + static_cast<float>(i % 7) * 5.0f;
+			m_roots[i]->transform.setLocalRotation(glm::vec3(0.0f, std::fmod(time * speed + static_cast<float>(i) * 37.0f, 360.0f), 0.0f));
+			m_roots[i]->updateSelfAndChild();
+		}
+	});
+}
+
+void StressScene::createTextures()
+{
+	//Checkerboards of distinct colors, mipmapped like textures loaded from disk
+	std::mt19937 random(m_settings.seed ^ 0x9E3779B9u);
+	std::uniform_int_distribution<int> channel(64, 255);
+	std::vector<unsigned char> pixels(TEXTURE_SIZE * TEXTURE_SIZE * 4);
+
+	m_textures.resize(m_settings.textures);
+	glGenTextures(static_cast<GLsizei>(m_textures.size()), m_textures.data());
+	for (unsigned int texture : m_textures)
+	{
+		const unsigned char color[3] = {
+			static_cast<unsigned char>(channel(random)),
+			static_cast<unsigned char>(channel(random)),
+			static_cast<unsigned char>(channel(random))
+		};
+		for (int y = 0; y < TEXTURE_SIZE; y++)
+		{
+			for (int x = 0; x < TEXTURE_SIZE; x++)
+			{
+				const bool dark = ((x / 8) + (y / 8)) % 2 == 0;
+				unsigned char* pixel = &pixels[(y * TEXTURE_SIZE + x) * 4];
+				for (int c = 0; c < 3; c++)
+				{
+					pixel[c] = dark ? static_cast<unsigned char>(color[c] / 2) : color[c];
+				}
+				pixel[3] = 255;
+			}
+		}
+
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, TEXTURE_SIZE, TEXTURE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glGenerateMipmap(GL_TEXTURE_2D);
+		GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, texture,
+			GpuMemoryTracker::textureBytes(TEXTURE_SIZE, TEXTURE_SIZE, 1, 4, true), "RGBA8", "StressScene");
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Entity.h"
+#include "InstanceBatch.h"
+#include "LocalLight.h"
+
+struct StressSceneSettings
+{
+	//Total entities, split into chains of hierarchyDepth parented entities
+	int			entities = 0;
+	int			hierarchyDepth = 1;
+	//Instanced copies of the prop model
+	int			props = 0;
+	int			lights = 0;
+	//Distinct diffuse textures cycled over the entities
+	int			textures = 1;
+	uint32_t	seed = 1;
+
+	[[nodiscard]] bool enabled() const
+	{
+		return entities > 0 || props > 0 || lights > 0;
+	}
+};
+
+//Procedural scene for scaling measurements: textured cubes in parent chains whose roots spin every
+//frame so the whole hierarchy is re-evaluated, instanced props and unshadowed point lights, all
+//scattered over a square that grows with the counts. The same settings and seed always produce
+//the same scene, so benchmark runs are comparable.
+class StressScene
+{
+public:
+	StressScene(const StressSceneSettings& settings, Model& propModel);
+	StressScene(const StressScene& other) = delete;
+	~StressScene();
+
+	//Rotates the chain roots to time seconds and updates their hierarchies
+	void update(float time);
+
+	//Every entity, roots and children
+	const std::vector<Entity*>& getEntities() const
+	{
+		return m_entities;
+	}
+
+	const std::vector<Entity*>& getRoots() const
+	{
+		return m_roots;
+	}
+
+	InstanceBatch& getProps()
+	{
+		return *m_props;
+	}
+
+	const std::vector<LocalLight>& getLights() const
+	{
+		return m_lights;
+	}
+
+private:
+	StressSceneSettings						m_settings;
+	std::vector<unsigned int>				m_textures;
+	std::vector<std::unique_ptr<Entity>>	m_ownedRoots;
+	std::vector<Entity*>					m_roots;
+	std::vector<Entity*>					m_entities;
+	std::unique_ptr<InstanceBatch>			m_props;
+	std::vector<LocalLight>					m_lights;
+
+	void createTextures();
+};
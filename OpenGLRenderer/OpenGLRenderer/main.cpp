@@ -2,8 +2,13 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <filesystem>
+#include <thread>
 
 #include <glm.hpp>
 #include <gtc/matrix_transform.hpp>
@@ -11,12 +16,35 @@
 
 #include "stb_image.h"
 
+#include "Benchmark.h"
 #include "Camera.h"
+#include "CameraPath.h"
+#include "ClusteredLighting.h"
+#include "CpuProfiler.h"
+#include "DeferredShading.h"
 #include "Entity.h"
+#include "FramePipeline.h"
+#include "GpuMemoryTracker.h"
+#include "GpuProfiler.h"
+#include "GLResource.h"
+#include "GpuVegetation.h"
+#include "HiZCulling.h"
+#include "ImageBasedLighting.h"
 #include "ImguiLayer.h"
+#include "JobSystem.h"
+#include "InstanceBatch.h"
+#include "LatencyMonitor.h"
+#include "LocalLightShadows.h"
 #include "Light.h"
+#include "RenderStats.h"
+#include "SceneBVH.h"
+#include "ShadowAtlas.h"
+#include "ShadowCache.h"
 #include "Shader.h"
 #include "Skybox.h"
+#include "SoftwareOcclusion.h"
+#include "StressScene.h"
+#include "StaticGeometry.h"
 
 
 void framebuffer_size_callback(GLFWwindow* wnd, int width, int height)
@@ -25,28 +53,33 @@ void framebuffer_size_callback(GLFWwindow* wnd, int width, int height)
 }
 
 bool cursorDisabled = false;
-void process_input(GLFWwindow* wnd, Camera* camera, float deltatTime)
+float lastX = 400;
+float lastY = 300;
+bool firstMouseInput = true;
+//Mouse movement since the last sample_input, written by the cursor callback during polling
+float mouseDeltaX = 0.0f;
+float mouseDeltaY = 0.0f;
+Camera camera;
+
+//Window events are polled on the main thread, the simulation only sees the sampled state
+InputState sample_input(GLFWwindow* wnd)
 {
 	if(glfwGetKey(wnd, GLFW_KEY_ESCAPE) == GLFW_PRESS)
 	{
 		glfwSetWindowShouldClose(wnd, true);
 	}
-	if (glfwGetKey(wnd, GLFW_KEY_W) == GLFW_PRESS)
-	{
-		camera->ProcessMovementInput(Camera_Movement::FORWARD, deltatTime);
-	}
-	if (glfwGetKey(wnd, GLFW_KEY_S) == GLFW_PRESS)
-	{
-		camera->ProcessMovementInput(Camera_Movement::BACKWARD, deltatTime);
-	}
-	if (glfwGetKey(wnd, GLFW_KEY_D) == GLFW_PRESS)
-	{
-		camera->ProcessMovementInput(Camera_Movement::RIGHT, deltatTime);
-	}
-	if (glfwGetKey(wnd, GLFW_KEY_A) == GLFW_PRESS)
-	{
-		camera->ProcessMovementInput(Camera_Movement::LEFT, deltatTime);
-	}
+
+	InputState input;
+	input.forward = glfwGetKey(wnd, GLFW_KEY_W) == GLFW_PRESS;
+	input.backward = glfwGetKey(wnd, GLFW_KEY_S) == GLFW_PRESS;
+	input.right = glfwGetKey(wnd, GLFW_KEY_D) == GLFW_PRESS;
+	input.left = glfwGetKey(wnd, GLFW_KEY_A) == GLFW_PRESS;
+	input.mouseDx = mouseDeltaX;
+	input.mouseDy = mouseDeltaY;
+	input.sampleTime = std::chrono::steady_clock::now();
+	mouseDeltaX = 0.0f;
+	mouseDeltaY = 0.0f;
+
 	if (glfwGetKey(wnd, GLFW_KEY_TAB) == GLFW_PRESS)
 	{
 		if (cursorDisabled)
@@ -60,12 +93,32 @@ void process_input(GLFWwindow* wnd, Camera* camera, float deltatTime)
 
 		cursorDisabled = !cursorDisabled;
 	}
+	return input;
 }
 
-float lastX = 400;
-float lastY = 300;
-bool firstMouseInput = true;
-Camera camera;
+void apply_input(const InputState& input, Camera* camera, float deltatTime)
+{
+	if (input.forward)
+	{
+		camera->ProcessMovementInput(Camera_Movement::FORWARD, deltatTime);
+	}
+	if (input.backward)
+	{
+		camera->ProcessMovementInput(Camera_Movement::BACKWARD, deltatTime);
+	}
+	if (input.right)
+	{
+		camera->ProcessMovementInput(Camera_Movement::RIGHT, deltatTime);
+	}
+	if (input.left)
+	{
+		camera->ProcessMovementInput(Camera_Movement::LEFT, deltatTime);
+	}
+	if (input.mouseDx != 0.0f || input.mouseDy != 0.0f)
+	{
+		camera->ProcessMouseMovement(input.mouseDx, input.mouseDy);
+	}
+}
 
 void mouse_callback(GLFWwindow* wnd, double xpos, double ypos)
 {
@@ -83,24 +136,133 @@ void mouse_callback(GLFWwindow* wnd, double xpos, double ypos)
 		return;
 	}
 
-	float xOffset = xpos - lastX;
-	float yOffset = ypos - lastY;
+	mouseDeltaX += xpos - lastX;
+	mouseDeltaY += ypos - lastY;
 	lastX = xpos;
 	lastY = ypos;
-
-	camera.ProcessMouseMovement(xOffset, yOffset);
 }
 
+//Tears the context down when main returns. Declared before any object that owns GL names, so it is
+//destroyed after all of them and their destructors still run with the context current
+struct GLContextScope
+{
+	GLContextScope() = default;
+	GLContextScope(const GLContextScope& other) = delete;
+
+	~GLContextScope()
+	{
+		GLDeletionQueue::get().shutdown();
+		glfwTerminate();
+	}
+};
+
 unsigned int loadTexture(const char* path);
 
-void DrawGeometry(Entity& soldier, Entity& floor, Shader& litShader);
-void DrawVegetation(Entity& grass, Shader& vegetationShader);
+void DrawGeometry(const std::vector<Entity*>& entities, Shader& shader, StaticGeometry* staticGeometry, bool bindMaterials);
+void DrawVegetation(InstanceBatch& grass, Shader& vegetationShader, const Frustum& frustum, CullingStats& stats);
 
 
-int main()
+int main(int argc, char** argv)
 {
+	//Forward by default, --deferred switches opaque geometry to the G-buffer path.
+	//--pcss and --shadow-kernel <taps> pick the shadow filter permutation.
+	//--profile records CPU markers, F9 dumps them; --trace <frames> also dumps once that many frames ran.
+	//--benchmark <scene> <camerapath> renders hidden at a fixed timestep and writes a JSON report,
+	//tuned with --frames, --warmup and --report.
+	//--record-camera <file> saves the camera of every frame at exit, --replay-camera <file> plays it back
+	//with the recorded frame times or, with --replay-timestep <seconds>, at a fixed step.
+	//--stress <entities> <depth> <props> <lights> <textures> adds a procedural scene, benchmark scene "stress" keeps the default props
+	//--single-thread runs simulation and rendering in turn on the main thread instead of pipelining them.
+	//--job-workers <count> sizes the job system, 0 runs every job on the thread that waits for it
+	bool useDeferred = false;
+	bool useSimulationThread = true;
+	int jobWorkers = -1;
+	int traceFrames = 0;
+	bool runBenchmark = false;
+	BenchmarkSettings benchmarkSettings;
+	std::string recordCameraPath;
+	std::string replayCameraPath;
+	float replayTimestep = 0.0f;
+	StressSceneSettings stressSettings;
+	ShadowFilter shadowFilter = ShadowFilter::PCF;
+	int shadowKernelSize = 8;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--deferred") == 0)
+		{
+			useDeferred = true;
+		}
+		else if (std::strcmp(argv[i], "--single-thread") == 0)
+		{
+			useSimulationThread = false;
+		}
+		else if (std::strcmp(argv[i], "--job-workers") == 0 && i + 1 < argc)
+		{
+			jobWorkers = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--pcss") == 0)
+		{
+			shadowFilter = ShadowFilter::PCSS;
+		}
+		else if (std::strcmp(argv[i], "--shadow-kernel") == 0 && i + 1 < argc)
+		{
+			shadowKernelSize = std::atoi(argv[++i]);
+		}
+		else if (std::strcmp(argv[i], "--profile") == 0)
+		{
+			CpuProfiler::setEnabled(true);
+		}
+		else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+		{
+			traceFrames = std::atoi(argv[++i]);
+			CpuProfiler::setEnabled(true);
+		}
+		else if (std::strcmp(argv[i], "--benchmark") == 0 && i + 2 < argc)
+		{
+			runBenchmark = true;
+			benchmarkSettings.scene = argv[++i];
+			benchmarkSettings.cameraPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			benchmarkSettings.frames = std::max(1, std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+		{
+			benchmarkSettings.warmupFrames = std::max(0, std::atoi(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--report") == 0 && i + 1 < argc)
+		{
+			benchmarkSettings.reportPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--record-camera") == 0 && i + 1 < argc)
+		{
+			recordCameraPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--replay-camera") == 0 && i + 1 < argc)
+		{
+			replayCameraPath = argv[++i];
+		}
+		else if (std::strcmp(argv[i], "--replay-timestep") == 0 && i + 1 < argc)
+		{
+			replayTimestep = static_cast<float>(std::atof(argv[++i]));
+		}
+		else if (std::strcmp(argv[i], "--stress") == 0 && i + 5 < argc)
+		{
+			stressSettings.entities = std::max(0, std::atoi(argv[++i]));
+			stressSettings.hierarchyDepth = std::max(1, std::atoi(argv[++i]));
+			stressSettings.props = std::max(0, std::atoi(argv[++i]));
+			stressSettings.lights = std::max(0, std::atoi(argv[++i]));
+			stressSettings.textures = std::max(1, std::atoi(argv[++i]));
+		}
+	}
+	const std::vector<std::string> shadowDefines = ShadowAtlas::getFilterDefines(shadowFilter, shadowKernelSize);
+	JobSystem::get().start(jobWorkers);
+
 	constexpr  int width = 1920;
 	constexpr int height = 1080;
+	constexpr float NEAR_PLANE = 0.1f;
+	constexpr float FAR_PLANE = 100.0f;
 
 	float rectangleVertices[] =
 	{
@@ -114,12 +276,34 @@ int main()
 		-1.0f, 1.0f,	0.0f, 1.0f
 	};
 
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	if (!glfwInit())
+	{
+		//Headless runs fail here first when no display server is reachable
+		std::cout << "ERROR::GLFW::INIT_FAILED" << std::endl;
+		if (runBenchmark)
+		{
+			std::cout << "Benchmark mode still needs a display, run it under Xvfb (xvfb-run) on headless machines" << std::endl;
+		}
+		return -1;
+	}
+	//Prefer 4.3 for the compute paths, everything else runs on 3.3
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	if (runBenchmark)
+	{
+		//Hidden window with an EGL context, renders through Mesa llvmpipe on machines without a GPU
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+	}
 
 	GLFWwindow* wnd = glfwCreateWindow(width, height, "OpenGL_Renderer", nullptr, nullptr);
+	if (wnd == nullptr)
+	{
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		wnd = glfwCreateWindow(width, height, "OpenGL_Renderer", nullptr, nullptr);
+	}
 	if(wnd == nullptr)
 	{
 		std::cout << "Failed to create GLFW window!" << std::endl;
@@ -134,11 +318,38 @@ int main()
 		std::cout << "Failed to initialized GLAD" << std::endl;
 		return -1;
 	}
+	GLExtensions::load((GLADloadproc)glfwGetProcAddress);
+	GLContextScope contextScope;
+
+	std::unique_ptr<Benchmark> benchmark;
+	CameraPath benchmarkPath;
+	if (runBenchmark)
+	{
+		if (!benchmarkPath.load(benchmarkSettings.cameraPath))
+		{
+			return -1;
+		}
+		benchmark = std::make_unique<Benchmark>(benchmarkSettings);
+		benchmark->setParameter("jobWorkers", static_cast<int>(JobSystem::get().getWorkerCount()));
+		glfwSwapInterval(0);
+	}
+
+	CameraPath recordedCamera;
+	CameraPath replayedCamera;
+	const bool replayCamera = !benchmark && !replayCameraPath.empty();
+	if (replayCamera && (!replayedCamera.load(replayCameraPath) || replayedCamera.empty()))
+	{
+		return -1;
+	}
+	size_t replayFrame = 0;
 
 	//Setup viewport
 	glViewport(0, 0, width, height);
 	glfwSetFramebufferSizeCallback(wnd, framebuffer_size_callback);
-	glfwSetCursorPosCallback(wnd, mouse_callback);
+	if (!benchmark && !replayCamera)
+	{
+		glfwSetCursorPosCallback(wnd, mouse_callback);
+	}
 
 	//Configuring depth buffer
 	glEnable(GL_DEPTH_TEST);
@@ -147,14 +358,20 @@ int main()
 	glEnable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
 
+	//Static geometry goes through multi-draw indirect when GL 4.3 is available
+	const bool useMultiDraw = GLExtensions::hasGL43();
+
 	//Compile shaders
-	Shader litShader("Shaders/ShadowBlinnPhong.vs", "Shaders/ShadowBlinnPhong.fs");
+	Shader litShader(useMultiDraw ? "Shaders/ShadowBlinnPhongMDI.vs" : "Shaders/ShadowBlinnPhong.vs", "Shaders/ShadowBlinnPhong.fs", shadowDefines);
 	Shader vegetationShader("Shaders/VegetationTransparent.vs", "Shaders/VegetationTransparent.fs");
 	Shader lightSrcShader("Shaders/LightSource.vs", "Shaders/LightSource.fs");
 	Shader skyboxShader("Shaders/Skybox.vs", "Shaders/Skybox.fs");
 	Shader envMappingShader("Shaders/EnvironmentMapping.vs", "Shaders/EnvironmentMapping.fs");
 	Shader framebufferShader("Shaders/Framebuffer.vs", "Shaders/Framebuffer.fs");
-	Shader depthShader("Shaders/SimpleDepthShader.vs", "Shaders/SimpleDepthShader.fs");
+	//Depth pre-pass shares the lit vertex shader so both passes produce identical depth for GL_EQUAL
+	Shader prePassShader(useMultiDraw ? "Shaders/ShadowBlinnPhongMDI.vs" : "Shaders/ShadowBlinnPhong.vs", "Shaders/SimpleDepthShader.fs");
+	Shader depthShader(useMultiDraw ? "Shaders/SimpleDepthShaderMDI.vs" : "Shaders/SimpleDepthShader.vs", "Shaders/SimpleDepthShader.fs");
+	Shader gBufferShader(useMultiDraw ? "Shaders/ShadowBlinnPhongMDI.vs" : "Shaders/ShadowBlinnPhong.vs", "Shaders/GBuffer.fs");
 
 	framebufferShader.use();
 	framebufferShader.setBool("screenTex", 0);
@@ -178,25 +395,67 @@ int main()
 	const std::filesystem::path workDir = std::filesystem::current_path();
 
 	 std::filesystem::path modelPath = workDir / "resources" / "models" / "soldier" / "CloneDC15sWhite.obj";
+	if (benchmark && benchmarkSettings.scene != "default" && benchmarkSettings.scene != "stress")
+	{
+		modelPath = benchmarkSettings.scene;
+	}
 	//Model soldier(modelPath.generic_string().c_str());
 	Entity soldier(modelPath.generic_string().c_str());
 	soldier.addChild(modelPath.generic_string().c_str());
 	soldier.getChild(0)->transform.setLocalPos(glm::vec3(5.0f, 0.1f, 0.0f));
+	soldier.transform.setLocalRotation(glm::vec3(180.0f, 180.0f, 0.0f));
 	soldier.updateSelfAndChild();
 
 	modelPath = workDir / "resources" / "models" / "terrain" / "terrain.obj";
 	Entity floor(modelPath.generic_string().c_str());
+	floor.updateSelfAndChild();
+
+	//Entities whose transforms the simulation owns, the renderer only reads their published matrices
+	std::vector<Entity*> sceneEntities = { &soldier, soldier.getChild(0).get(), &floor };
+	for (Entity* entity : sceneEntities)
+	{
+		entity->transform.publish();
+	}
 
 	modelPath = workDir / "resources" / "models" / "grass" / "plane.obj";
 	Entity grass(modelPath.generic_string().c_str());
 
+	//Grass is scattered and culled on the GPU when compute is available,
+	//otherwise all cards go through one instanced draw
+	std::unique_ptr<GpuVegetation> gpuGrass;
+	std::unique_ptr<InstanceBatch> grassBatch;
+	if (GLExtensions::hasGL43())
+	{
+		const std::filesystem::path densityPath = workDir / "resources" / "textures" / "grass_density.png";
+		unsigned int densityMap = 0;
+		if (std::filesystem::exists(densityPath))
+		{
+			densityMap = TextureFromFile(densityPath.filename().generic_string().c_str(), densityPath.parent_path().generic_string());
+		}
+
+		gpuGrass = std::make_unique<GpuVegetation>(floor, grass, densityMap, GpuVegetationSettings());
+	}
+	else
+	{
+		grassBatch = std::make_unique<InstanceBatch>(grass);
+		Transform grassTransform;
+		grassTransform.setLocalRotation(glm::vec3(0.0f, 270.0f, 0.0f));
+		for (int i = 0; i < 10; i++)
+		{
+			grassTransform.setLocalPos(glm::vec3(-i + 5, -1.0f, -i));
+			grassTransform.computeModelMatrix();
+			grassBatch->add(grassTransform.getModelMatrix());
+		}
+		grassBatch->upload();
+	}
+
 	//Rectangle VAO
-	unsigned int rectVAO, rectVBO;
-	glGenVertexArrays(1, &rectVAO);
-	glGenBuffers(1, &rectVBO);
-	glBindVertexArray(rectVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, rectVBO);
+	GLVertexArray rectVAO = GLVertexArray::create();
+	GLBuffer rectVBO = GLBuffer::create();
+	glBindVertexArray(rectVAO.get());
+	glBindBuffer(GL_ARRAY_BUFFER, rectVBO.get());
 	glBufferData(GL_ARRAY_BUFFER, sizeof(rectangleVertices), &rectangleVertices, GL_STATIC_DRAW);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::BUFFER, rectVBO.get(), sizeof(rectangleVertices), "vec2 + vec2", "Post-process");
 
 	glEnableVertexAttribArray(0);
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
@@ -209,63 +468,51 @@ int main()
 	litShader.setVec3("_Material.texture_diffuse1", 1.0f, 1.0f, 1.0f);
 	litShader.setVec3("_Material.texture_specular1", 0.5f, 0.5f, 0.5f);
 	litShader.setFloat("_Material.shiness", 32.0f);
-	litShader.setFloat("_PointLights[0].constant", 1.0f);
-	litShader.setFloat("_PointLights[0].linear", 0.09f);
-	litShader.setFloat("_PointLights[0].quadratic", 0.032f);
-	litShader.setVec3("_PointLights[0].position", pointLightPositions[0]);
-	litShader.setVec3("_PointLights[0].ambient", lightAmbient);
-	litShader.setVec3("_PointLights[0].diffuse", glm::vec3(0.0f, 1.0f, 1.0f));
-	litShader.setVec3("_PointLights[0].specular", glm::vec3(0.0f, 1.0f, 1.0f));
-	litShader.setFloat("_PointLights[0].intensity", pointLightIntensity);
-
-	litShader.setFloat("_PointLights[1].constant", 1.0f);
-	litShader.setFloat("_PointLights[1].linear", 0.09f);
-	litShader.setFloat("_PointLights[1].quadratic", 0.032f);
-	litShader.setVec3("_PointLights[1].position", pointLightPositions[1]);
-	litShader.setVec3("_PointLights[1].ambient", lightAmbient);
-	litShader.setVec3("_PointLights[1].diffuse", glm::vec3(0.0f, 0.0f, 1.0f));
-	litShader.setVec3("_PointLights[1].specular", glm::vec3(0.0f, 0.0f, 1.0f));
-	litShader.setFloat("_PointLights[1].intensity", pointLightIntensity);
-
-	litShader.setFloat("_PointLights[2].constant", 1.0f);
-	litShader.setFloat("_PointLights[2].linear", 0.09f);
-	litShader.setFloat("_PointLights[2].quadratic", 0.032f);
-	litShader.setVec3("_PointLights[2].position", pointLightPositions[2]);
-	litShader.setVec3("_PointLights[2].ambient", lightAmbient);
-	litShader.setVec3("_PointLights[2].diffuse", glm::vec3(1.0f, 0.0f, 1.0f));
-	litShader.setVec3("_PointLights[2].specular", glm::vec3(1.0f, 0.0f, 1.0f));
-	litShader.setFloat("_PointLights[2].intensity", pointLightIntensity);
-
-	litShader.setFloat("_PointLights[3].constant", 1.0f);
-	litShader.setFloat("_PointLights[3].linear", 0.09f);
-	litShader.setFloat("_PointLights[3].quadratic", 0.032f);
-	litShader.setVec3("_PointLights[3].position", pointLightPositions[3]);
-	litShader.setVec3("_PointLights[3].ambient", lightAmbient);
-	litShader.setVec3("_PointLights[3].diffuse", glm::vec3(1.0f, 0.0f, 0.0f));
-	litShader.setVec3("_PointLights[3].specular", glm::vec3(1.0f, 0.0f, 0.0f));
-	litShader.setFloat("_PointLights[3].intensity", pointLightIntensity);
 	litShader.setInt("albedo", 0);
 
-	//Spot light
-	litShader.setVec3("_SpotLight.position", camera.cameraPos);
-	litShader.setVec3("_SpotLight.direction", camera.cameraFront);
-	litShader.setFloat("_SpotLight.cutOff", glm::cos(glm::radians(12.5f)));
-	litShader.setFloat("_SpotLight.outerCutOff", glm::cos(glm::radians(17.5f)));
-	litShader.setVec3("_SpotLight.ambient", lightAmbient);
-	litShader.setVec3("_SpotLight.diffuse", lightDiffuse);
-	litShader.setVec3("_SpotLight.specular", lightSpecular);
-	litShader.setFloat("_SpotLight.intensity", lightIntensity);
+	gBufferShader.use();
+	gBufferShader.setFloat("_Material.shiness", 32.0f);
+
+	//Point and spot lights, shaded through the cluster grid
+	const glm::vec3 pointLightColors[] = {
+	glm::vec3(0.0f, 1.0f, 1.0f),
+	glm::vec3(0.0f, 0.0f, 1.0f),
+	glm::vec3(1.0f, 0.0f, 1.0f),
+	glm::vec3(1.0f, 0.0f, 0.0f)
+	};
+
+	std::vector<LocalLight> localLights;
+	for (int i = 0; i < 4; i++)
+	{
+		LocalLight pointLight;
+		pointLight.position = pointLightPositions[i];
+		pointLight.diffuse = pointLightColors[i];
+		pointLight.specular = pointLightColors[i];
+		pointLight.intensity = pointLightIntensity;
+		pointLight.castsShadows = true;
+		localLights.push_back(pointLight);
+	}
+
+	//Flashlight following the camera
+	LocalLight spotLight;
+	spotLight.type = LightType::SPOT;
+	spotLight.cutOff = glm::cos(glm::radians(12.5f));
+	spotLight.outerCutOff = glm::cos(glm::radians(17.5f));
+	spotLight.diffuse = lightDiffuse;
+	spotLight.specular = lightSpecular;
+	spotLight.intensity = lightIntensity;
+	const size_t spotLightIndex = localLights.size();
+	localLights.push_back(spotLight);
 
 	//Skybox
 	std::unique_ptr<Skybox> skybox = std::make_unique<Skybox>();
 
+	//Image based lighting, precomputed once and cached on disk
+	ImageBasedLighting ibl(*skybox, workDir / "cache" / "ibl");
+
 	//Camera stuff
 	glm::vec3 up = glm::vec3(0.0, 1.0f, 0.0f);
 	
-	//Timer stuff
-	float deltaTime = 0.0f;
-	float lastFrame = 0.0f;
-
 	//Imgui setup
 	ImguiLayer imgui;
 	imgui.init(wnd);
@@ -274,27 +521,34 @@ int main()
 	int frameCount = 0;
 	int prevFPS = 0;
 	float prevTime = glfwGetTime();
+	FrameTimeHistory frameTimes;
 
 	//Framebuffers
-	unsigned int FBO;
-	glGenFramebuffers(1, &FBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	GLFramebuffer FBO = GLFramebuffer::create();
+	glBindFramebuffer(GL_FRAMEBUFFER, FBO.get());
 
-	unsigned int framebufferTexture;
-	glGenTextures(1, &framebufferTexture);
-	glBindTexture(GL_TEXTURE_2D, framebufferTexture);
+	GLTexture framebufferTexture = GLTexture::create();
+	glBindTexture(GL_TEXTURE_2D, framebufferTexture.get());
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, framebufferTexture.get(),
+		GpuMemoryTracker::textureBytes(width, height, 1, 4, false), "RGB8", "Main framebuffer");
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, framebufferTexture, 0);
-
-	unsigned int RBO;
-	glGenRenderbuffers(1, &RBO);
-	glBindRenderbuffer(GL_RENDERBUFFER, RBO);
-	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, framebufferTexture.get(), 0);
+
+	//Depth is a texture so the occlusion pyramid can be built from it
+	GLTexture framebufferDepth = GLTexture::create();
+	glBindTexture(GL_TEXTURE_2D, framebufferDepth.get());
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, width, height, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+	GpuMemoryTracker::get().allocate(GpuResourceKind::TEXTURE, framebufferDepth.get(),
+		GpuMemoryTracker::textureBytes(width, height, 1, 4, false), "DEPTH24_STENCIL8", "Main framebuffer");
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, framebufferDepth.get(), 0);
 
 	auto fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 	if (fboStatus != GL_FRAMEBUFFER_COMPLETE)
@@ -302,91 +556,413 @@ int main()
 		std::cout << "Framebuffer error: " << fboStatus << std::endl;
 	}
 
-	//Depth map framebuffer
-	unsigned int depthFBO;
-	glGenFramebuffers(1, &depthFBO);
-	glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
+	//Shadow maps, every cascade and local light view is a tile of one atlas
+	const int CASCADE_COUNT = 4;
+	const float CASCADE_SPLIT_LAMBDA = 0.75f;
+	const int CASCADE_RESOLUTIONS[Light::MAX_CASCADES] = { 2048, 2048, 1024, 1024 };
+	ShadowAtlas shadowAtlas;
 
-	const unsigned int SHADOW_WIDTH = 2048, SHADOW_HEIGHT = 2048;
-	unsigned int depthMap;
-	glGenTextures(1, &depthMap);
-	glBindTexture(GL_TEXTURE_2D, depthMap);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-	float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
-	glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-	//Init depth cubemap
-	unsigned int depthCubemap;
-	glGenTextures(1, &depthCubemap);
-	
-	glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
-	for (int i = 0; i < 6; i++)
+	//Lights
+	Light dirLight(-10.0f, 10.0f, -10.0f, 10.0f, 0.01f, 8.5f, lightPos);
+
+	//Stress props get their own copy of the grass model, instance attributes are bound per VAO
+	std::unique_ptr<Entity> stressPropModel;
+	std::unique_ptr<StressScene> stressScene;
+	if (stressSettings.enabled())
 	{
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT,
-			SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+		modelPath = workDir / "resources" / "models" / "grass" / "plane.obj";
+		stressPropModel = std::make_unique<Entity>(modelPath.generic_string().c_str());
+		stressScene = std::make_unique<StressScene>(stressSettings, *stressPropModel);
+		localLights.insert(localLights.end(), stressScene->getLights().begin(), stressScene->getLights().end());
+		for (Entity* entity : stressScene->getEntities())
+		{
+			entity->transform.publish();
+			sceneEntities.push_back(entity);
+		}
+		if (benchmark)
+		{
+			benchmark->setParameter("entities", stressSettings.entities);
+			benchmark->setParameter("hierarchyDepth", stressSettings.hierarchyDepth);
+			benchmark->setParameter("props", stressSettings.props);
+			benchmark->setParameter("lights", stressSettings.lights);
+			benchmark->setParameter("textures", stressSettings.textures);
+		}
 	}
 
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	//Visibility
+	SceneBVH sceneBVH;
+	for (Entity* entity : sceneEntities)
+	{
+		sceneBVH.insert(entity);
+	}
 
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	std::unique_ptr<StaticGeometry> staticGeometry;
+	if (useMultiDraw)
+	{
+		staticGeometry = std::make_unique<StaticGeometry>();
+		for (Entity* entity : sceneEntities)
+		{
+			staticGeometry->add(entity);
+		}
+		staticGeometry->build();
+	}
 
-	//Lights
-	Light dirLight(-10.0f, 10.0f, -10.0f, 10.0f, 0.01f, 8.5f, lightPos);
+	HiZCulling hiZ(width, height);
+	ClusteredLighting clusteredLighting(width, height);
 
-	//Game loop
-	while(!glfwWindowShouldClose(wnd))
+	std::unique_ptr<DeferredShading> deferred;
+	if (useDeferred)
+	{
+		deferred = std::make_unique<DeferredShading>(width, height, framebufferDepth.get(), shadowDefines);
+	}
+
+	//The two nearest cascades follow the camera every frame
+	ShadowCache shadowCache(2);
+	LocalLightShadows localShadows;
+
+	//Light, shadow and IBL inputs shared by the forward lit shader and the deferred lighting pass
+	auto setLightingUniforms = [&](Shader& shader, const glm::vec3& viewPos)
 	{
-		float currentFrame = glfwGetTime();
-		deltaTime = currentFrame - lastFrame;
+		shader.setVec3("_ViewPos", viewPos);
+
+		shader.setVec3("_DirLight.direction", -0.2f, -1.0f, -0.3f);
+		shader.setVec3("_DirLight.ambient", lightAmbient);
+		shader.setVec3("_DirLight.diffuse", lightDiffuse);
+		shader.setVec3("_DirLight.specular", lightSpecular);
+
+		const std::vector<ShadowCascade>& cascades = shadowCache.getCascades();
+		for (size_t i = 0; i < cascades.size(); i++)
+		{
+			const std::string index = "[" + std::to_string(i) + "]";
+			shader.setMat4("_CascadeMatrices" + index, cascades[i].worldToClip);
+			shader.setFloat("_CascadeSplits" + index, cascades[i].splitDepth);
+			const std::vector<glm::ivec4>* tiles = shadowAtlas.getTiles(ShadowAtlas::makeKey(ShadowOwner::CASCADE, (uint32_t)i));
+			if (tiles)
+			{
+				shader.setVec4("_CascadeTiles" + index, glm::vec4((*tiles)[0]) / (float)ShadowAtlas::SIZE);
+			}
+		}
+		shader.setInt("_CascadeCount", (int)cascades.size());
+		shadowAtlas.bind(shader, 4, 11);
+		localShadows.bind(shader);
+		ibl.bind(shader, 5);
+		clusteredLighting.bind(shader, 8);
+	};
+
+	//Terrain is the only large occluder, rasterized on worker threads each frame
+	SoftwareOcclusion softwareOcclusion;
+	for (const auto& mesh : floor.getMeshes())
+	{
+		std::vector<glm::vec3> positions;
+		positions.reserve(mesh.getVertices().size());
+		for (const Vertex& vertex : mesh.getVertices())
+		{
+			positions.push_back(vertex.position);
+		}
+		softwareOcclusion.addOccluder(positions, mesh.getIndices(), floor.transform.getRenderMatrix());
+	}
+
+	Frustum cameraFrustum;
+	Frustum shadowFrustum;
+	CullingStats cameraCullStats;
+	CullingStats shadowCullStats;
+	std::vector<Entity*> visibleEntities;
+	std::vector<Entity*> shadowCasters[Light::MAX_CASCADES];
+	std::vector<std::vector<Entity*>> localShadowCasters;
+	std::vector<uint8_t> localShadowDirty;
+
+	//Opaque geometry is laid down depth only first, then shaded once per pixel with GL_EQUAL
+	bool depthPrePass = true;
+
+	GpuProfiler gpuProfiler;
+
+	const char* TRACE_PATH = "cpu_trace.json";
+	int profiledFrames = 0;
+	bool traceKeyDown = false;
+
+	GpuMemoryTracker& gpuMemory = GpuMemoryTracker::get();
+	gpuMemory.queryDriver();
+
+	//Simulation: input, camera and entity transforms. Runs on its own thread one frame ahead of
+	//the renderer, or inline before each rendered frame with --single-thread
+	FramePipeline pipeline;
+	uint64_t simulatedFrames = 0;
+	float lastFrame = 0.0f;
+	//Sum of the recorded frame times, starts from zero like glfwGetTime did when the path was recorded
+	float replayTime = 0.0f;
+	auto simulate = [&](FrameSnapshot& snapshot)
+	{
+		PROFILE_SCOPE("Simulate");
+		const auto simulationStart = std::chrono::steady_clock::now();
+		snapshot.frameIndex = simulatedFrames++;
+		snapshot.quit = false;
+
+		//Benchmarks advance by a fixed step so every run renders the same poses
+		float currentFrame = benchmark ? static_cast<float>(snapshot.frameIndex) * benchmarkSettings.timestep
+									   : static_cast<float>(glfwGetTime());
+		float deltaTime = benchmark ? benchmarkSettings.timestep : currentFrame - lastFrame;
 		lastFrame = currentFrame;
+		snapshot.inputTime = simulationStart;
 
-		process_input(wnd, &camera, deltaTime);
+		if (benchmark)
+		{
+			benchmarkPath.apply(currentFrame, camera);
+		}
+		else if (replayCamera)
+		{
+			//Recorded frame times replace the measured ones so time dependent state replays too
+			if (replayTimestep > 0.0f)
+			{
+				deltaTime = replayTimestep;
+				currentFrame = static_cast<float>(replayFrame) * replayTimestep;
+				replayedCamera.apply(currentFrame, camera);
+			}
+			else
+			{
+				deltaTime = replayedCamera.getSamples()[replayFrame].deltaTime;
+				replayTime += deltaTime;
+				currentFrame = replayTime;
+				replayedCamera.applySample(replayFrame, camera);
+			}
+			replayFrame++;
+			snapshot.quit = replayTimestep > 0.0f ? static_cast<float>(replayFrame) * replayTimestep > replayedCamera.getDuration()
+												  : replayFrame >= replayedCamera.getSamples().size();
+		}
+		else
+		{
+			const InputState input = pipeline.takeInput();
+			apply_input(input, &camera, deltaTime);
+			//No poll has happened before the first frame
+			if (input.sampleTime.time_since_epoch().count() != 0)
+			{
+				snapshot.inputTime = input.sampleTime;
+			}
+		}
 
-		//first pass
-		//render depth map
-		glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-		glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0); 
-		glClear(GL_DEPTH_BUFFER_BIT);
-		glEnable(GL_DEPTH_TEST);
-		glEnable(GL_CULL_FACE);
+		if (!recordCameraPath.empty())
+		{
+			recordedCamera.add({ camera.cameraPos, camera.yaw, camera.pitch, deltaTime });
+		}
 
-		//configure shaders
-		depthShader.use();
-		depthShader.setMat4("lightSpace", dirLight.getWorldToClip());
+		{
+			PROFILE_SCOPE("Transform update");
+			soldier.updateSelfAndChild();
+			floor.updateSelfAndChild();
+			if (stressScene)
+			{
+				stressScene->update(currentFrame);
+			}
+		}
 
-		//directional light pass
-		glCullFace(GL_FRONT);
-		DrawGeometry(soldier, floor, depthShader);
-		glCullFace(GL_BACK);
+		snapshot.time = currentFrame;
+		snapshot.deltaTime = deltaTime;
+		snapshot.cameraPos = camera.cameraPos;
+		snapshot.cameraFront = camera.cameraFront;
+		snapshot.view = camera.GetViewMatrix();
+		snapshot.transforms.resize(sceneEntities.size());
+		JobSystem::get().parallelFor("Snapshot transforms", sceneEntities.size(), 1024, [&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				snapshot.transforms[i] = { sceneEntities[i]->transform.getModelMatrix(), sceneEntities[i]->transform.getVersion() };
+			}
+		});
+		snapshot.simulationMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - simulationStart).count();
+	};
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	std::thread simulationThread;
+	if (useSimulationThread)
+	{
+		simulationThread = std::thread([&]()
+		{
+			while (FrameSnapshot* snapshot = pipeline.beginWrite())
+			{
+				simulate(*snapshot);
+				const bool quit = snapshot->quit;
+				pipeline.publish();
+				if (quit)
+				{
+					break;
+				}
+			}
+		});
+	}
+
+	LatencyMonitor latencyMonitor;
+	int64_t lastLatencyFrame = -1;
+	float lastRenderMs = 0.0f;
 
-		//point light pass
-		glBindFramebuffer(GL_FRAMEBUFFER, depthFBO);
-		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap, 0);
-		glClear(GL_DEPTH_BUFFER_BIT); 
+	//Game loop, the main thread renders and processes window events
+	while(!glfwWindowShouldClose(wnd))
+	{
+		CpuProfiler::beginFrame();
+		gpuMemory.beginFrame();
+		PROFILE_SCOPE("Frame");
+		const auto frameStart = std::chrono::steady_clock::now();
 
-		glCullFace(GL_FRONT); 
-		//DrawGeometry(soldier, floor, depthShader);
-		glCullFace(GL_BACK); 
+		if (!useSimulationThread)
+		{
+			FrameSnapshot* next = pipeline.beginWrite();
+			simulate(*next);
+			pipeline.publish();
+		}
+		const FrameSnapshot* snapshot = pipeline.acquire();
+		if (snapshot == nullptr)
+		{
+			break;
+		}
+		const auto renderStart = std::chrono::steady_clock::now();
+		const uint64_t frameIndex = snapshot->frameIndex;
+		const float currentFrame = snapshot->time;
+		const float deltaTime = snapshot->deltaTime;
+		const glm::mat4 cameraView = snapshot->view;
+		const glm::vec3 viewPos = snapshot->cameraPos;
+		const glm::vec3 viewFront = snapshot->cameraFront;
+		const auto inputTime = snapshot->inputTime;
+		const float simulationMs = snapshot->simulationMs;
+		const bool lastSnapshot = snapshot->quit;
+		if (benchmark)
+		{
+			benchmark->addSimulationTime(static_cast<int64_t>(frameIndex), simulationMs);
+		}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		frameTimes.push(deltaTime * 1000.0f);
+		//Counters of the previous, complete frame are the ones shown
+		const RenderStats lastFrameStats = RenderStats::current();
+		RenderStats::current().reset();
+
+		gpuProfiler.beginFrame();
+
+		const bool tracePressed = glfwGetKey(wnd, GLFW_KEY_F9) == GLFW_PRESS;
+		if ((tracePressed && !traceKeyDown && CpuProfiler::isEnabled()) || (traceFrames > 0 && ++profiledFrames == traceFrames))
+		{
+			CpuProfiler::dump(TRACE_PATH, traceFrames > 0 ? traceFrames : CpuProfiler::MAX_FRAMES);
+		}
+		traceKeyDown = tracePressed;
+
+		glm::mat4 projection = glm::mat4(1.0f);
+		projection = glm::perspective(glm::radians(45.0f), (float)width / height, NEAR_PLANE, FAR_PLANE);
+
+		//Occluders only depend on the camera, rasterize them while transforms, culling and shadows are set up
+		softwareOcclusion.beginFrame(projection * cameraView);
+
+		//Visibility for camera and shadow caster views
+		{
+			PROFILE_SCOPE("Transform apply");
+			JobSystem::get().parallelFor("Transform apply", sceneEntities.size(), 1024, [&](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					sceneEntities[i]->transform.applySnapshot(snapshot->transforms[i].model, snapshot->transforms[i].version);
+				}
+			});
+			sceneBVH.refit();
+			if (staticGeometry)
+			{
+				staticGeometry->updateTransforms();
+			}
+		}
+
+		cameraCullStats.reset();
+		shadowCullStats.reset();
+		cameraFrustum.update(projection * cameraView);
+		sceneBVH.cull(cameraFrustum, visibleEntities, cameraCullStats);
+
+		//Shadow cascades fit to the camera frustum splits, each culls its own casters
+		if (lightPos != dirLight.getPosition())
+		{
+			dirLight.setPosition(lightPos);
+		}
+		dirLight.updateCascades(cameraView, glm::radians(45.0f), (float)width / height, NEAR_PLANE, FAR_PLANE,
+			CASCADE_COUNT, CASCADE_SPLIT_LAMBDA, CASCADE_RESOLUTIONS, sceneBVH.getBounds());
+		const std::vector<ShadowCascade>& fittedCascades = dirLight.getCascades();
+
+		//Atlas tiles for cascades and on-screen shadowed local lights, cascades are never shrunk
+		shadowAtlas.beginFrame();
+		for (size_t i = 0; i < fittedCascades.size(); i++)
+		{
+			shadowAtlas.request(ShadowAtlas::makeKey(ShadowOwner::CASCADE, (uint32_t)i), 1, CASCADE_RESOLUTIONS[i], FLT_MAX);
+		}
+		localShadows.request(localLights, shadowAtlas, cameraFrustum, viewPos, height * 0.5f / glm::tan(glm::radians(45.0f) * 0.5f));
+		shadowAtlas.allocate();
+		localShadows.update(localLights, shadowAtlas);
+
+		bool cascadeDirty[Light::MAX_CASCADES] = {};
+		bool shadowsDirty = false;
+		shadowCache.beginFrame();
+		for (size_t i = 0; i < fittedCascades.size(); i++)
+		{
+			if (shadowAtlas.wasReallocated(ShadowAtlas::makeKey(ShadowOwner::CASCADE, (uint32_t)i)))
+			{
+				shadowCache.invalidate((int)i);
+			}
+			const ShadowCascade& cascade = shadowCache.selectCascade((int)i, fittedCascades[i], dirLight.getVersion());
+			shadowFrustum.update(cascade.worldToClip);
+			sceneBVH.cull(shadowFrustum, shadowCasters[i], shadowCullStats);
+			cascadeDirty[i] = shadowCache.needsRender((int)i, shadowCasters[i]);
+			shadowsDirty |= cascadeDirty[i];
+		}
+
+		//Point and spot light views, each culls its own casters and keeps its tile while nothing changed
+		const std::vector<LocalShadowView>& localViews = localShadows.getViews();
+		localShadowCasters.resize(localViews.size());
+		localShadowDirty.assign(localViews.size(), 0);
+		for (size_t i = 0; i < localViews.size(); i++)
+		{
+			shadowFrustum.update(localViews[i].worldToClip);
+			sceneBVH.cull(shadowFrustum, localShadowCasters[i], shadowCullStats);
+			localShadowDirty[i] = localShadows.needsRender(i, localShadowCasters[i]);
+			shadowsDirty |= localShadowDirty[i] != 0;
+		}
+
+		//first pass
+		//render shadow atlas tiles, skipped entirely while every cascade and local view is cached
+		gpuProfiler.beginPass("Shadows");
+		if (shadowsDirty)
+		{
+			shadowAtlas.beginRender();
+			glEnable(GL_DEPTH_TEST);
+			glEnable(GL_CULL_FACE);
+
+			//configure shaders
+			depthShader.use();
+
+			//directional light pass, one tile per dirty cascade
+			glCullFace(GL_FRONT);
+			const std::vector<ShadowCascade>& cascades = shadowCache.getCascades();
+			for (size_t i = 0; i < fittedCascades.size(); i++)
+			{
+				const std::vector<glm::ivec4>* tiles = shadowAtlas.getTiles(ShadowAtlas::makeKey(ShadowOwner::CASCADE, (uint32_t)i));
+				if (!cascadeDirty[i] || !tiles)
+				{
+					continue;
+				}
+				shadowAtlas.beginTile((*tiles)[0]);
+				depthShader.setMat4("lightSpace", cascades[i].worldToClip);
+				DrawGeometry(shadowCasters[i], depthShader, staticGeometry.get(), false);
+			}
+
+			//point and spot light pass, one tile per dirty view
+			for (size_t i = 0; i < localViews.size(); i++)
+			{
+				if (!localShadowDirty[i])
+				{
+					continue;
+				}
+				shadowAtlas.beginTile(localViews[i].viewport);
+				depthShader.setMat4("lightSpace", localViews[i].worldToClip);
+				DrawGeometry(localShadowCasters[i], depthShader, staticGeometry.get(), false);
+			}
+			glCullFace(GL_BACK);
+
+			shadowAtlas.endRender();
+		}
+		gpuProfiler.endPass();
 
 		//render normal scene
 		glViewport(0, 0, width, height);
-		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO.get());
+		RenderStats::current().fboSwitches++;
 		glEnable(GL_DEPTH_TEST);
 		glEnable(GL_CULL_FACE);
 		glCullFace(GL_BACK);
@@ -398,9 +974,6 @@ int main()
 		//Imgui
 		imgui.newFrame();
 
-		glm::mat4 projection = glm::mat4(1.0f);
-		projection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f);
-
 		//Render light source
 		/*lightSrcShader.use();
 		lightSrcShader.setMat4("view", camera.GetViewMatrix());
@@ -419,45 +992,121 @@ int main()
 		}
 		*/
 		
-		//Render models
-		litShader.use();
+		//Occluders were rasterized during the culling and shadow work above
+		softwareOcclusion.cull(visibleEntities);
 
-		litShader.setMat4("view", camera.GetViewMatrix());
-		litShader.setMat4("projection", projection); 
-		litShader.setMat4("lightSpaceMatrix", dirLight.getWorldToClip());
-		litShader.setVec3("_ViewPos", camera.cameraPos);
-		//litShader.setVec3("_Light.position", lightModel * glm::vec4(lightPos, 1.0));
-		litShader.setVec3("_Light.position", camera.cameraPos);
+		//Occlusion against last frame's depth, commands are culled on the GPU when multi-draw is used
+		if (staticGeometry)
+		{
+			staticGeometry->prepare(visibleEntities, true);
+			hiZ.cullCommands(*staticGeometry);
+		}
+		else
+		{
+			hiZ.cull(visibleEntities);
+		}
 
-		//Directiona light uniforms
-		litShader.setVec3("_DirLight.direction", -0.2f, -1.0f, -0.3f);
-		litShader.setVec3("_DirLight.ambient", lightAmbient);
-		litShader.setVec3("_DirLight.diffuse", lightDiffuse);
-		litShader.setVec3("_DirLight.specular", lightSpecular);
+		localLights[spotLightIndex].position = viewPos;
+		localLights[spotLightIndex].direction = viewFront;
+		clusteredLighting.update(localLights, cameraView, projection, NEAR_PLANE, FAR_PLANE);
 
-		litShader.setVec3("_SpotLight.position", camera.cameraPos);
-		litShader.setVec3("_SpotLight.direction", camera.cameraFront);
+		//Depth pre-pass into the shared depth attachment
+		if (depthPrePass)
+		{
+			gpuProfiler.beginPass("Depth pre-pass");
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			prePassShader.use();
+			prePassShader.setMat4("view", cameraView);
+			prePassShader.setMat4("projection", projection);
+			if (staticGeometry)
+			{
+				staticGeometry->submit(prePassShader, false);
+			}
+			else
+			{
+				DrawGeometry(visibleEntities, prePassShader, nullptr, false);
+			}
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			gpuProfiler.endPass();
+		}
 
-		litShader.setInt("_Material.diffuse", 0);
-		litShader.setInt("_Material.specular", 1);
-		litShader.setInt("shadowMap", 4);
+		//Render models
+		gpuProfiler.beginPass("Opaque");
+		Shader& geometryShader = deferred ? gBufferShader : litShader;
+		if (deferred)
+		{
+			deferred->beginGeometryPass();
+		}
+		if (depthPrePass)
+		{
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
 
-		glActiveTexture(GL_TEXTURE4);
-		glBindTexture(GL_TEXTURE_2D, depthMap);
+		geometryShader.use();
+		geometryShader.setMat4("view", cameraView);
+		geometryShader.setMat4("projection", projection);
+		if (!deferred)
+		{
+			setLightingUniforms(litShader, viewPos);
+		}
 
 		// 4. use our shader program when we want to render an object
-		DrawGeometry(soldier, floor, litShader);
+		if (staticGeometry)
+		{
+			staticGeometry->submit(geometryShader, true);
+		}
+		else
+		{
+			DrawGeometry(visibleEntities, geometryShader, nullptr, true);
+		}
+
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+		gpuProfiler.endPass();
+
+		hiZ.build(framebufferDepth.get(), projection * cameraView);
+
+		if (deferred)
+		{
+			Shader& lightingShader = deferred->getLightingShader();
+			gpuProfiler.beginPass("Deferred lighting");
+			lightingShader.use();
+			setLightingUniforms(lightingShader, viewPos);
+			deferred->lightingPass(FBO.get(), projection * cameraView);
+			gpuProfiler.endPass();
+		}
+
+		gpuProfiler.beginPass("Vegetation");
+		if (gpuGrass)
+		{
+			gpuGrass->cull(cameraFrustum, viewPos);
+		}
 
 		vegetationShader.use();
 
-		vegetationShader.setMat4("view", camera.GetViewMatrix());
+		vegetationShader.setMat4("view", cameraView);
 		vegetationShader.setMat4("projection", projection);
-		vegetationShader.setVec3("_ViewPos", camera.cameraPos);
+		vegetationShader.setVec3("_ViewPos", viewPos);
 
-		DrawVegetation(grass, vegetationShader);
+		if (gpuGrass)
+		{
+			gpuGrass->Draw(vegetationShader);
+		}
+		else
+		{
+			DrawVegetation(*grassBatch, vegetationShader, cameraFrustum, cameraCullStats);
+		}
+		if (stressScene && stressScene->getProps().getInstanceCount() > 0)
+		{
+			DrawVegetation(stressScene->getProps(), vegetationShader, cameraFrustum, cameraCullStats);
+		}
+		gpuProfiler.endPass();
 
 		//Render skybox
-		skybox->Draw(projection, glm::mat4(glm::mat3(camera.GetViewMatrix())));
+		gpuProfiler.beginPass("Skybox");
+		skybox->Draw(projection, glm::mat4(glm::mat3(cameraView)));
+		gpuProfiler.endPass();
 
 		//ImGui
 		frameCount++;
@@ -466,52 +1115,125 @@ int main()
 			prevFPS = frameCount;
 			frameCount = 0;
 			prevTime = currentFrame;
+			gpuMemory.queryDriver();
 		}
 
 		imgui.drawPerfomance(deltaTime, prevFPS);
+		imgui.drawRenderStats(lastFrameStats, frameTimes);
+		imgui.drawFramePipeline(useSimulationThread, simulationMs, lastRenderMs, latencyMonitor.getHistory());
+		imgui.drawCullingStats("camera", cameraCullStats);
+		imgui.drawCullingStats("shadow", shadowCullStats);
+		imgui.drawOcclusionStats("software", softwareOcclusion.getStats());
+		imgui.drawOcclusionStats("Hi-Z", hiZ.getStats());
+		imgui.drawClusterStats(clusteredLighting.getStats());
+		imgui.drawShadowStats(shadowCache.getStats(), shadowAtlas.getStats(), localShadows.getStats());
+		imgui.drawDepthPrePass(depthPrePass);
+		imgui.drawGpuTimings(gpuProfiler);
+		imgui.drawGpuMemory(gpuMemory);
 		imgui.drawDirLightProperties(lightAmbient, lightDiffuse, lightSpecular, lightPos);
 
+		gpuProfiler.beginPass("ImGui");
 		imgui.render();
+		gpuProfiler.endPass();
 
 		//Post processing step
+		gpuProfiler.beginPass("Post-process");
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 		framebufferShader.use();
-		glBindVertexArray(rectVAO);
+		glBindVertexArray(rectVAO.get());
 		glDisable(GL_DEPTH_TEST);
 		glDisable(GL_CULL_FACE);
-		glBindTexture(GL_TEXTURE_2D, framebufferTexture);
+		glBindTexture(GL_TEXTURE_2D, framebufferTexture.get());
 		glDrawArrays(GL_TRIANGLES, 0, 6);
+		RenderStats::current().fboSwitches++;
+		RenderStats::current().textureBinds++;
+		RenderStats::current().addDraw(6);
+		gpuProfiler.endPass();
+		gpuProfiler.endFrame();
+
+		latencyMonitor.endFrame(frameIndex, inputTime);
+		if (benchmark && latencyMonitor.getResolvedFrame() > lastLatencyFrame)
+		{
+			lastLatencyFrame = latencyMonitor.getResolvedFrame();
+			benchmark->addLatency(lastLatencyFrame, latencyMonitor.getLatencyMs());
+		}
+
+		//The snapshot slot goes back to the simulation, which starts the next frame during the swap
+		lastRenderMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - renderStart).count();
+		pipeline.release();
+		if (lastSnapshot)
+		{
+			glfwSetWindowShouldClose(wnd, true);
+		}
+
+		if (benchmark)
+		{
+			const float cpuMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+			benchmark->endFrame(cpuMs, gpuProfiler);
+			if (benchmark->isFinished())
+			{
+				glfwSetWindowShouldClose(wnd, true);
+			}
+		}
+
+		//Objects released this frame are deleted once the GPU has retired it
+		GLDeletionQueue::get().endFrame();
 
 		glfwSwapBuffers(wnd);
 		glfwPollEvents();
+		if (!benchmark && !replayCamera)
+		{
+			pipeline.submitInput(sample_input(wnd));
+		}
+	}
+
+	pipeline.stop();
+	if (simulationThread.joinable())
+	{
+		simulationThread.join();
+	}
+
+	int exitCode = 0;
+	if (benchmark && !benchmark->writeReport())
+	{
+		exitCode = 1;
+	}
+	if (!recordCameraPath.empty() && !recordedCamera.save(recordCameraPath))
+	{
+		exitCode = 1;
 	}
 
 	imgui.shutdown();
-	glfwTerminate();
-	return 0;
+	JobSystem::get().stop();
+	return exitCode;
 }
 
-void DrawGeometry(Entity& soldier, Entity& floor, Shader& shader)
+void DrawGeometry(const std::vector<Entity*>& entities, Shader& shader, StaticGeometry* staticGeometry, bool bindMaterials)
 {
-	soldier.transform.setLocalRotation(glm::vec3(180.0f, 180.0f, 0.0f));
-	soldier.updateSelfAndChild();
-	shader.setMat4("model", soldier.transform.getModelMatrix());
-	soldier.Draw(shader);
-	shader.setMat4("model", soldier.getChild(0)->transform.getModelMatrix());
-	soldier.getChild(0)->Draw(shader);
+	PROFILE_SCOPE("DrawGeometry");
+	if (staticGeometry)
+	{
+		staticGeometry->Draw(entities, shader, bindMaterials);
+		return;
+	}
 
-	shader.setMat4("model", floor.transform.getModelMatrix());
-	floor.Draw(shader);
+	for (Entity* entity : entities)
+	{
+		shader.setMat4("model", entity->transform.getRenderMatrix());
+		entity->Draw(shader);
+	}
 }
 
-void DrawVegetation(Entity& grass, Shader& shader)
+void DrawVegetation(InstanceBatch& grass, Shader& shader, const Frustum& frustum, CullingStats& stats)
 {
-	grass.transform.setLocalRotation(glm::vec3(0.0f, 270.0f, 0.0f));
-	for (int i = 0; i < 10; i++)
+	//The batch is culled as a whole, instances are not split per frame
+	stats.nodesTested++;
+	if (!frustum.isVisible(grass.getBounds()))
 	{
-		grass.transform.setLocalPos(glm::vec3(-i + 5, -1.0f, -i));
-		grass.updateSelfAndChild();
-		shader.setMat4("model", grass.transform.getModelMatrix());
-		grass.Draw(shader);
+		stats.nodesCulled++;
+		return;
 	}
+
+	stats.entitiesVisible += grass.getInstanceCount();
+	grass.Draw(shader);
 }
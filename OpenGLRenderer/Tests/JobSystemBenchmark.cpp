@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include <glm.hpp>
+#include <gtc/matrix_transform.hpp>
+
+#include "JobSystem.h"
+
+//Scaling of parallelFor over a transform-update-like workload, from 1 worker up to N.
+//Usage: JobSystemBenchmark [maxWorkers] [items] [grain]
+
+namespace
+{
+	constexpr int REPEATS = 20;
+
+	float run(std::vector<glm::mat4>& matrices, size_t grain)
+	{
+		float best = 1e9f;
+		for (int repeat = 0; repeat < REPEATS; repeat++)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			JobSystem::get().parallelFor("benchmark", matrices.size(), grain, [&matrices](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(static_cast<float>(i), 0.0f, 0.0f));
+					for (int step = 0; step < 16; step++)
+					{
+						model = glm::rotate(model, 0.01f, glm::vec3(0.0f, 1.0f, 0.0f));
+					}
+					matrices[i] = model;
+				}
+			});
+			best = std::min(best, std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+		}
+		return best;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const unsigned int hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	const int maxWorkers = argc > 1 ? std::max(1, std::atoi(argv[1])) : static_cast<int>(hardwareThreads);
+	const size_t items = argc > 2 ? static_cast<size_t>(std::atoll(argv[2])) : 200000;
+	const size_t grain = argc > 3 ? static_cast<size_t>(std::atoll(argv[3])) : 1024;
+
+	std::vector<glm::mat4> matrices(items);
+	std::printf("%zu items, grain %zu, best of %d, %u hardware threads\n", items, grain, REPEATS, hardwareThreads);
+
+	//0 workers is the serial baseline, the calling thread runs every range
+	JobSystem::get().start(0);
+	const float serialMs = run(matrices, grain);
+	JobSystem::get().stop();
+	std::printf("workers %2d: %8.3f ms  speedup %.2fx\n", 0, serialMs, 1.0f);
+
+	for (int workers = 1; workers <= maxWorkers; workers++)
+	{
+		JobSystem::get().start(workers);
+		const float ms = run(matrices, grain);
+		JobSystem::get().stop();
+		std::printf("workers %2d: %8.3f ms  speedup %.2fx\n", workers, ms, serialMs / ms);
+	}
+	return 0;
+}
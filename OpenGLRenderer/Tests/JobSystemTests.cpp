@@ -0,0 +1,198 @@
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+
+namespace
+{
+	int failures = 0;
+
+	void check(bool condition, const char* name)
+	{
+		std::printf("%s %s\n", condition ? "PASS" : "FAIL", name);
+		if (!condition)
+		{
+			failures++;
+		}
+	}
+
+	void testParallelFor(const char* mode)
+	{
+		std::printf("-- parallelFor, %s\n", mode);
+		JobSystem& jobs = JobSystem::get();
+
+		//Every index written exactly once, whatever the grain
+		bool covered = true;
+		for (size_t grain : { size_t(1), size_t(7), size_t(64), size_t(100000) })
+		{
+			std::vector<int> hits(10000, 0);
+			jobs.parallelFor("test", hits.size(), grain, [&hits](size_t begin, size_t end)
+			{
+				for (size_t i = begin; i < end; i++)
+				{
+					hits[i]++;
+				}
+			});
+			for (int hit : hits)
+			{
+				covered &= hit == 1;
+			}
+		}
+		check(covered, "every index visited once");
+
+		std::vector<uint64_t> values(100000);
+		std::iota(values.begin(), values.end(), 1);
+		std::atomic<uint64_t> sum{ 0 };
+		jobs.parallelFor("test", values.size(), 1000, [&values, &sum](size_t begin, size_t end)
+		{
+			uint64_t partial = 0;
+			for (size_t i = begin; i < end; i++)
+			{
+				partial += values[i];
+			}
+			sum += partial;
+		});
+		check(sum == values.size() * (values.size() + 1) / 2, "sum matches the serial result");
+
+		//Inner loops run on workers that are themselves inside a job
+		std::atomic<int> inner{ 0 };
+		jobs.parallelFor("outer", 16, 1, [&jobs, &inner](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				jobs.parallelFor("inner", 100, 10, [&inner](size_t innerBegin, size_t innerEnd)
+				{
+					inner += static_cast<int>(innerEnd - innerBegin);
+				});
+			}
+		});
+		check(inner == 1600, "nested parallelFor completes");
+
+		int empty = 0;
+		jobs.parallelFor("empty", 0, 8, [&empty](size_t, size_t)
+		{
+			empty++;
+		});
+		check(empty == 0, "empty range runs nothing");
+	}
+
+	void testDependencies(const char* mode)
+	{
+		std::printf("-- counters, %s\n", mode);
+		JobSystem& jobs = JobSystem::get();
+
+		//Three stages chained through counters, no job may start before the previous stage finished
+		bool ordered = true;
+		for (int iteration = 0; iteration < 100; iteration++)
+		{
+			JobCounter first;
+			JobCounter second;
+			JobCounter third;
+			std::atomic<int> firstDone{ 0 };
+			std::atomic<int> secondDone{ 0 };
+			std::atomic<bool> stageOrder{ true };
+			for (int i = 0; i < 8; i++)
+			{
+				jobs.run("first", [&firstDone]()
+				{
+					firstDone++;
+				}, &first);
+			}
+			for (int i = 0; i < 8; i++)
+			{
+				jobs.run("second", [&firstDone, &secondDone, &stageOrder]()
+				{
+					if (firstDone != 8)
+					{
+						stageOrder = false;
+					}
+					secondDone++;
+				}, &second, &first);
+			}
+			jobs.run("third", [&secondDone, &stageOrder]()
+			{
+				if (secondDone != 8)
+				{
+					stageOrder = false;
+				}
+			}, &third, &second);
+
+			jobs.wait(third);
+			jobs.wait(second);
+			jobs.wait(first);
+			ordered &= stageOrder && first.isDone() && second.isDone() && third.isDone();
+		}
+		check(ordered, "continuations start after their dependency finished");
+
+		//A dependency that is already done does not hold the job back
+		JobCounter done;
+		JobCounter after;
+		bool ran = false;
+		jobs.run("after", [&ran]()
+		{
+			ran = true;
+		}, &after, &done);
+		jobs.wait(after);
+		check(ran, "finished dependency starts the job right away");
+
+		//Waiting on a counter that never had jobs returns immediately
+		JobCounter unused;
+		jobs.wait(unused);
+		check(unused.isDone(), "unused counter is done");
+	}
+
+	void testNoWorkers()
+	{
+		std::printf("-- start(0)\n");
+		JobSystem& jobs = JobSystem::get();
+		jobs.start(0);
+		check(jobs.getWorkerCount() == 0, "no worker threads");
+
+		const std::thread::id caller = std::this_thread::get_id();
+		std::mutex mutex;
+		std::vector<std::thread::id> threads;
+		JobCounter counter;
+		for (int i = 0; i < 32; i++)
+		{
+			jobs.run("job", [&mutex, &threads]()
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				threads.push_back(std::this_thread::get_id());
+			}, &counter);
+		}
+		check(!counter.isDone(), "jobs wait in the queue until someone waits");
+		jobs.wait(counter);
+
+		bool onCaller = threads.size() == 32;
+		for (const std::thread::id& thread : threads)
+		{
+			onCaller &= thread == caller;
+		}
+		check(onCaller, "every job ran on the waiting thread");
+
+		testParallelFor("0 workers");
+		testDependencies("0 workers");
+		jobs.stop();
+	}
+}
+
+int main()
+{
+	//Not started, every job runs inline
+	testParallelFor("not started");
+	testDependencies("not started");
+
+	testNoWorkers();
+
+	JobSystem::get().start(4);
+	testParallelFor("4 workers");
+	testDependencies("4 workers");
+	JobSystem::get().stop();
+
+	std::printf("%d failure(s)\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#include <cstdio>
+#include <vector>
+
+#include <glm.hpp>
+#include <gtc/matrix_transform.hpp>
+
+#include "JobSystem.h"
+#include "SoftwareOcclusion.h"
+
+//Camera at the origin looking down -Z at a 8x8 wall 5 units away, boxes are placed around it.
+//Built once per SIMD path, see the Makefile.
+
+namespace
+{
+	int failures = 0;
+
+	void check(bool condition, const char* name)
+	{
+		std::printf("%s %s\n", condition ? "PASS" : "FAIL", name);
+		if (!condition)
+		{
+			failures++;
+		}
+	}
+
+	struct Item
+	{
+		AABB bounds;
+
+		AABB getWorldBounds() const
+		{
+			return bounds;
+		}
+	};
+
+	AABB makeBox(const glm::vec3& center, const glm::vec3& extents)
+	{
+		AABB box;
+		box.min = center - extents;
+		box.max = center + extents;
+		return box;
+	}
+
+	void addWall(SoftwareOcclusion& occlusion)
+	{
+		const std::vector<glm::vec3> positions = {
+			glm::vec3(-4.0f, -4.0f, 0.0f), glm::vec3(4.0f, -4.0f, 0.0f),
+			glm::vec3(4.0f, 4.0f, 0.0f), glm::vec3(-4.0f, 4.0f, 0.0f)
+		};
+		const std::vector<uint32_t> indices = { 0, 1, 2, 0, 2, 3 };
+		occlusion.addOccluder(positions, indices, glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -5.0f)));
+	}
+
+	void runCases(const char* mode)
+	{
+		std::printf("-- %s\n", mode);
+		const float aspect = static_cast<float>(SoftwareOcclusion::WIDTH) / SoftwareOcclusion::HEIGHT;
+		const glm::mat4 projection = glm::perspective(glm::radians(90.0f), aspect, 0.1f, 100.0f);
+		const glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+		SoftwareOcclusion occlusion;
+		addWall(occlusion);
+		occlusion.beginFrame(projection * view);
+		occlusion.wait();
+
+		//The wall covers the center of the buffer at its depth, the corners stay clear
+		const float* depth = occlusion.getDepth();
+		const int center = (SoftwareOcclusion::HEIGHT / 2) * SoftwareOcclusion::WIDTH + SoftwareOcclusion::WIDTH / 2;
+		check(depth[center] < 1.0f, "wall rasterized at the center");
+		check(depth[0] == 1.0f, "corner left at far depth");
+
+		check(!occlusion.isVisible(makeBox(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(1.0f))), "box behind the wall is occluded");
+		check(occlusion.isVisible(makeBox(glm::vec3(14.0f, 0.0f, -10.0f), glm::vec3(1.0f))), "box beside the wall is visible");
+		check(occlusion.isVisible(makeBox(glm::vec3(0.0f, 0.0f, -3.0f), glm::vec3(0.5f))), "box in front of the wall is visible");
+		check(occlusion.isVisible(makeBox(glm::vec3(200.0f, 0.0f, -10.0f), glm::vec3(1.0f))), "off-screen box is left to frustum culling");
+		check(occlusion.isVisible(makeBox(glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.5f))), "box crossing the near plane is kept");
+
+		//cull() drops exactly the occluded item
+		Item hidden{ makeBox(glm::vec3(0.0f, 0.0f, -10.0f), glm::vec3(1.0f)) };
+		Item shown{ makeBox(glm::vec3(14.0f, 0.0f, -10.0f), glm::vec3(1.0f)) };
+		std::vector<Item*> items = { &hidden, &shown };
+		occlusion.cull(items);
+		check(items.size() == 1 && items[0] == &shown && occlusion.getStats().culled == 1, "cull removes the occluded item");
+	}
+}
+
+int main()
+{
+#if defined(__AVX__)
+	if (!__builtin_cpu_supports("avx"))
+	{
+		std::printf("SKIP AVX path, the CPU has no AVX\n");
+		return 0;
+	}
+	std::printf("Testing the AVX path\n");
+#else
+	std::printf("Testing the SSE path\n");
+#endif
+
+	//Inline, then with the rasterization spread over workers
+	runCases("inline");
+	JobSystem::get().start(3);
+	runCases("3 workers");
+	JobSystem::get().stop();
+
+	std::printf("%d failure(s)\n", failures);
+	return failures == 0 ? 0 : 1;
+}